@@ -0,0 +1,101 @@
+/*********************************************************************************************//**
+* @file camera_model_cache.h
+*
+* Camera parameters of scaled and cropped images header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef CAMERA_MODEL_CACHE_H
+#define CAMERA_MODEL_CACHE_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <map>
+
+// Aruco libraries
+#include <aruco/aruco.h>
+#include <aruco/cameraparameters.h>
+
+// OpenCV libraries
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Camera parameters of one image configuration
+typedef struct CameraModel
+{
+    aruco::CameraParameters parameters;             // parameters for aruco lib
+    double cameraMatrix[4];                         // fx, fy, cx, cy for pose solver
+    double distortion[5];                           // k1, k2, p1, p2, k3
+} CameraModel;
+
+// Calibration is valid for full resolution image, processed image can be scaled
+// (Bayer half resolution, binning or decimation of camera) and cropped (region of interest)
+// Camera parameters are calculated once for each configuration
+class CameraModelCache
+{
+public:
+    explicit CameraModelCache(size_t paramMaxModels=16);
+
+    // Calibration of full resolution image, size is zero if calibration file does not contain it
+    void set_calibration(const cv::Mat &intrinsics, const cv::Mat &distortion, const cv::Size &size);
+    // Resolution of image of given size relative to calibration in x and y, default if size of calibration is unknown
+    // Different scales of x and y mean anisotropic binning or decimation of camera
+    cv::Point2d scale_of_size(const cv::Size &size, double defaultScale) const;
+    // Parameters of image scaled by scale and cropped to crop given in pixels of scaled image
+    // Reference is valid until next call, cache is cleared when it is full
+    const CameraModel &model(const cv::Point2d &scale, const cv::Rect &crop);
+
+    inline size_t size() const
+    {
+        return models.size();
+    }
+
+private:
+    typedef struct Key
+    {
+        double scaleX,scaleY;
+        int x,y,width,height;
+        bool operator<(const Key &other) const;
+    } Key;
+
+    size_t maxModels;                               // count of cached configurations
+    cv::Mat intrinsics;                             // camera matrix of full resolution image
+    cv::Mat distortion;                             // distortion coeffs
+    cv::Size imageSize;                             // size of full resolution image
+    std::map<Key,CameraModel> models;               // parameters of used configurations
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //CAMERA_MODEL_CACHE_H
@@ -0,0 +1,88 @@
+/*********************************************************************************************//**
+* @file dataset_reader.h
+*
+* Reader of recorded images from bag file or video header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef DATASET_READER_H
+#define DATASET_READER_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <string>
+
+// Standard ROS libraries
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/Image.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Images are read in order of recording, bag images are returned as messages, video frames as Mono8
+// Files with suffix ".bag" are read as bag file, other files as video
+class DatasetReader
+{
+public:
+    DatasetReader();
+    ~DatasetReader();
+
+    // Topic is used only for bag file
+    bool open(const std::string &filename, const std::string &topic);
+    void close();
+    // Next image and its time, false at the end of dataset
+    // Message is empty for video, image is not changed for bag file
+    bool read(sensor_msgs::ImageConstPtr &message, cv::Mat &image, ros::Time &stamp);
+
+private:
+    bool read_bag(sensor_msgs::ImageConstPtr &message, ros::Time &stamp);
+    bool read_video(cv::Mat &image, ros::Time &stamp);
+
+    bool isBag;                                     // type of dataset
+    rosbag::Bag bag;                                // bag file
+    rosbag::View *view;                             // images of topic in bag file
+    rosbag::View::iterator viewIterator;            // actual message of bag file
+    cv::VideoCapture video;                         // video file
+    cv::Mat frame;                                  // actual frame of video
+    int frameCounter;                               // count of read frames of video
+    double videoFps;                                // frames per second of video
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //DATASET_READER_H
@@ -42,11 +42,11 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <ros/ros.h>
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/image_encodings.h>
-#include <tf/transform_broadcaster.h>
-#include <tf/transform_listener.h>
+#include <tf2_msgs/TFMessage.h>
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/Pose2D.h>
 #include <geometry_msgs/PoseArray.h>
+#include <geometry_msgs/TransformStamped.h>
 #include <visualization_msgs/Marker.h>
 #include <std_msgs/Int16.h>
 #include <image_transport/image_transport.h>
@@ -57,6 +57,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <utility>
 
 // Aruco libraries
 #include <aruco/aruco.h>
@@ -72,6 +73,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 // my message
 #include "aruco_positioning_system//ArUcoMarkers.h"
+#include "aruco_positioning_system//ArUcoPoseAtTime.h"
+
+// My libraries
+#include <marker_id_filter.h>
+#include <pose_shm.h>
+#include <marker_map_index.h>
+#include <planar_pose_solver.h>
+#include <rigid_transform.h>
+#include <frame_quality.h>
+#include <marker_tracker.h>
+#include <luma_ingest.h>
+#include <pose_history.h>
+#include <marker_map_snapshot.h>
+#include <space_model.h>
+#include <camera_model_cache.h>
+#include <stationary_detector.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -80,25 +97,13 @@ class ViewPoint_Estimator
 {
 public:
     enum Pattern {NOT_EXISTING, CHESSBOARD, CIRCLES_GRID, MARKERS};
+    enum FrameQualityMode {QUALITY_OFF, QUALITY_MAPPING, QUALITY_SKIP};
+    enum SpaceModel {SPACE_3D, SPACE_PLANE};
 
     typedef struct MarkerInfo
     {
             // Marker ID
             int markerID;
-            // Position of marker to another marker
-            geometry_msgs::Pose AllMarkersPose;
-            // Transformation of Marker to another marker
-            tf::StampedTransform AllMarkersTransform;
-            // Transformation of marker to WORLD [0,0,0]
-            tf::StampedTransform AllMarkersTransformGlobe;
-            // Position of marker to WORLD [0,0,0]
-            geometry_msgs::Pose AllMarkersPoseGlobe;
-            // Actual position of camera over marker
-            geometry_msgs::Pose CurrentCameraPose;
-            // Actuak Transformation of camera over marker
-            tf::Transform CurrentCameraTf;
-            // Sign of acitivity (visibility) of marker
-            bool active;
             // Realated marker ID, (define ID of which marker is relative to actual marker)
             int relatedMarkerID;
 
@@ -107,33 +112,111 @@ public:
 public:
     explicit ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMakerSize);
     ~ViewPoint_Estimator();
-    tf::Transform arucoMarker2Tf(const aruco::Marker &marker);
+    static void arucoMarker2Transform(const MarkerPose &pose, RigidTransform &transform);
     void image_callback(const sensor_msgs::ImageConstPtr &original_image);
-    void publish_tfs(bool world_option);
-    void publish_marker(geometry_msgs::Pose markerPose, int MarkerID, int rank);
+    void publish_tfs(bool world_option, bool whole_map=true);
+    void publish_marker(const RigidTransform &markerTransform, int MarkerID, int relatedRank);
     bool load_calibration_file(std::string filename);
     bool markers_find_pattern(cv::Mat input_image,cv::Mat output_image);
+    // Preprocessing is shared by node and offline processing
+    // Gray image of message, Mono8, YUV and Bayer without colour conversion, image can share data with message
+    bool image_from_message(const sensor_msgs::ImageConstPtr &message, cv::Mat &image);
+    // Resolution relative to calibration and region of interest of gray image, image is cropped to region
+    bool prepare_image(cv::Mat &image, cv::Point2d &scale, cv::Rect &crop) const;
+    // Camera model is changed only if resolution or region is changed
+    void select_camera_model(const cv::Point2d &scale, const cv::Rect &crop);
+    // Camera parameters of whole image of given size, resolution relative to calibration like in prepare_image
+    aruco::CameraParameters camera_parameters_of_size(const cv::Size &size);
+    // Detection and processing can be separated, detection does not change estimator and runs in any thread
+    void setup_detector(aruco::MarkerDetector &detector) const;
+    void detect_markers(aruco::MarkerDetector &detector, const cv::Mat &input_image, std::vector<aruco::Marker> &detected) const;
+    void measure_frame(const cv::Mat &input_image, FrameQuality &quality) const;
+    bool process_detected_markers(std::vector<aruco::Marker> &detected, const ros::Time &stamp, const FrameQuality &quality);
 
     inline void wait_for_start(const std_msgs::EmptyPtr& message)
     {
         StartNow=true;
     }
+    // Global position interpolated to requested time from history
+    bool pose_at_time(aruco_positioning_system::ArUcoPoseAtTime::Request &request,
+                      aruco_positioning_system::ArUcoPoseAtTime::Response &response);
+
+    // Results of last processed image
+    inline bool position_visible() const
+    {
+        return ArUcoMarkersMsgs.visibility;
+    }
+    inline const RigidTransform &world_position() const
+    {
+        return worldPosition;
+    }
+    inline int number_of_mapped_markers() const
+    {
+        return markersCounter;
+    }
+    inline int number_of_bad_frames() const
+    {
+        return badFrames;
+    }
+    inline const PoseHistory &pose_history() const
+    {
+        return *poseHistory;
+    }
+    inline const aruco::CameraParameters &camera_parameters() const
+    {
+        return arucoCalibParams;
+    }
+    // Mapped markers, index is from 0 to number_of_mapped_markers()-1
+    inline int mapped_marker_id(int j) const
+    {
+        return AllMarkers[j].markerID;
+    }
+    inline void mapped_marker_position(int j, RigidTransform &transform) const
+    {
+        markerGlobeTransforms.get(j,transform);
+    }
+    // Published versions of map, readers in other threads register own slot and read without locks
+    inline MarkerMapSnapshots &map_snapshots()
+    {
+        return mapSnapshots;
+    }
+
+private:
+    void add_tf(const RigidTransform &transform, const ros::Time &stamp, const std::string &frame_id, const std::string &child_frame_id);
+    void send_tfs();
+    void add_marker_tfs(const MarkerMapSnapshot &map, int j, const ros::Time &stamp, bool world_option);
+    void publish_map_tfs(const MarkerMapSnapshot &map, const ros::Time &stamp, bool world_option, bool whole_map);
+    void publish_map_snapshot();
+    bool check_frame_quality(const FrameQuality &quality);
+    void update_camera_model(const cv::Point2d &scale, const cv::Rect &crop);
+    bool process_markers(const ros::Time &stamp, cv::Mat output_image, bool add_new_markers);
+    template<class Space> void map_new_markers();
+    int closest_visible_marker();
+    void publish_shared_memory();
+    void republish_last_position(const ros::Time &stamp);
 
 private:
-    cv::Mat I;
+    cv::Mat I;                                      // image for drawing
     ros::Publisher my_markers_pub;                  // publisher of my message
     aruco_positioning_system::ArUcoMarkers ArUcoMarkersMsgs;
     ros::Publisher pose3D_pub;                      // 3D pose publisher
     ros::Publisher pose_3D_array;                   // 3D pose array
     ros::Publisher marker_pub;                      // marker visualization
+    ros::ServiceServer pose_at_time_srv;            // service of global position in past
     std::string filename;                           // calibration file path
     std::string type_of_space;                      // plane or 3D space
+    SpaceModel spaceModel;                          // space model of mapping
     cv::Mat *intrinsics;                            // camera intrinsics
     cv::Mat *distortion_coeff;                      // camera distortion coeffs
     cv::Size *image_size;                           // image_size
     Pattern calibration_pattern;                    // type of calibration pattern
     float markerSize;                               // marker geometry
     aruco::CameraParameters arucoCalibParams;       // camera parameters for aruco lib
+    aruco::MarkerDetector MDetector;                // detector of markers, only ID decoding
+    std::vector<aruco::Marker> markers;             // detected markers in actual image
+    PlanarPoseSolver poseSolver;                    // pose of all detected markers at once
+    std::vector<MarkerPose> markerPoses;            // poses of detected markers in camera frame
+    MarkerIdFilter markerIdFilter;                  // accepted IDs of markers
     int numberOfAllMarkers;                         // size of dynamical array
     bool regionOfInterest;                          // ROI allow
     int ROIx;                                       // ROI X
@@ -145,13 +228,55 @@ private:
     MarkerInfo *AllMarkers;                         // pole pre poziciu kazdeho markera - markre pevne na zemi
     int markersCounter;                             // counter of actuals markers
     int markerCounter_before;                       // counter of actual markers before image processing
-    tf::TransformListener *myListener;              // listener for TF
-    tf::TransformBroadcaster myBroadcaster;         // broadcaster
+    ros::Publisher tf_pub;                          // publisher of TFs, same topic as tf::TransformBroadcaster
     int indexActualCamera;                          // actual camera, which is closer to some marker
-    tf::StampedTransform myWorldPosition;           // global position to World TF
-    geometry_msgs::Pose myWorldPositionPose;        // global position to World
+    RigidTransform worldPosition;                   // global position to World
     bool StartNow;                                  // information about start image processing after start of program
     bool StartNowFromParameter;                     // or start after revieving starting message
+    bool showImage;                                 // window with detected markers
+    // Preallocated data of per-frame processing
+    std::vector<std::string> markerFrameNames;      // names of TFs "marker_N"
+    std::vector<std::string> cameraFrameNames;      // names of TFs "camera_N"
+    std::vector<std::string> markerGlobeFrameNames; // names of TFs "marker_globe_N"
+    std::string worldFrameName;                     // name of TF "world"
+    std::string globalPositionFrameName;            // name of TF "myGlobalPosition"
+    std::vector<geometry_msgs::TransformStamped> tfPool; // TFs of one publishing, elements are kept between images
+    size_t tfCount;                                 // count of used TFs in pool
+    std::vector<unsigned int> tfPublishedRound;     // last publishing with TFs of each marker
+    unsigned int tfRound;                           // number of publishing
+    tf2_msgs::TFMessage tfMessage;                  // all TFs sent at once
+    visualization_msgs::Marker rvizMarker;          // marker visualization message
+    PoseShmWriter poseShm;                          // shared memory output for local consumers
+    // Transforms of markers, indexed same as AllMarkers, converted to ROS types only for publishing
+    RigidTransformArray markerTransforms;           // transform of marker to its related marker
+    RigidTransformArray markerGlobeTransforms;      // transform of marker to world
+    RigidTransformArray cameraTransforms;           // last transform of camera to marker, only for TFs
+    RigidTransformArray visibleTransforms;          // camera to each visible marker of actual image
+    RigidTransformArray visibleGlobeTransforms;     // each visible marker to world
+    RigidTransformArray visibleWorldTransforms;     // camera to world over each visible marker
+    MarkerMapIndex markerMapIndex;                  // lookup of mapped markers by ID and position
+    std::vector<int> visibleMarkers;                // indexes of markers visible in actual image
+    std::vector<size_t> newMarkers;                 // detected markers, which are not in map
+    std::vector<int> neighbourMarkers;              // indexes of markers close to actual position
+    bool tfWholeMap;                                // TFs of all markers are published with every image
+    double tfNeighbourRadius;                       // radius of neighbourhood with published TFs
+    int tfMapSlice;                                 // count of other markers with published TFs in one image
+    int tfMapSliceStart;                            // round robin position in published part of map
+    FrameQualityGate frameQualityGate;              // sharpness and exposure of images
+    FrameQualityMode frameQualityMode;              // what bad image can not do
+    int badFrames;                                  // count of bad images
+    MarkerTracker markerTracker;                    // tracking of markers between full detections
+    LumaIngest lumaIngest;                          // gray image from message without colour conversion
+    cv::Point2d cameraScale;                        // resolution of processed image relative to calibration in x and y
+    cv::Rect cameraCrop;                            // region of processed image in pixels of scaled image
+    CameraModelCache cameraModels;                  // camera parameters of each scale and crop
+    StationaryDetector stationaryDetector;          // unchanged scene of parked robot
+    int stationaryDuty;                             // every Nth image of stationary scene is processed
+    bool stationarySkipped;                         // previous image was not processed
+    PoseHistory *poseHistory;                       // last global positions with time
+    // Mapping changes working map above, localisation and publishing read published version
+    MarkerMapSnapshots mapSnapshots;                // immutable versions of map
+    int mapReader;                                  // reader slot of localisation
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
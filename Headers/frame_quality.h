@@ -0,0 +1,90 @@
+/*********************************************************************************************//**
+* @file frame_quality.h
+*
+* Sharpness and exposure check of images on subsampled grid header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef FRAME_QUALITY_H
+#define FRAME_QUALITY_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Statistics of image on subsampled grid
+typedef struct FrameQuality
+{
+    double mean;                                    // mean intensity
+    double sharpness;                               // mean squared difference of neighbour pixels
+    double saturated;                               // ratio of saturated pixels
+    double dark;                                    // ratio of black pixels
+} FrameQuality;
+
+// Blurred and badly exposed images are recognized before detection of markers
+// Sharpness is compared to absolute limit and to slowly changing reference of previous images
+class FrameQualityGate
+{
+public:
+    FrameQualityGate();
+
+    // Distance of measured pixels in both directions
+    void set_step(int paramStep);
+    // Image is bad, if its sharpness is under limit or under ratio of reference, or if it has too many saturated or black pixels
+    void set_limits(double minSharpness, double sharpnessRatio, double maxSaturated, double maxDark);
+
+    // Statistics of Mono8 image, it does not change gate
+    void measure(const cv::Mat &image, FrameQuality &quality) const;
+    // Decision about image, reference sharpness is updated
+    bool accept(const FrameQuality &quality);
+
+    inline double reference_sharpness() const
+    {
+        return referenceSharpness;
+    }
+
+private:
+    int step;                                       // distance of measured pixels
+    double minSharpness;                            // absolute limit of sharpness
+    double sharpnessRatio;                          // limit of sharpness relative to reference
+    double maxSaturated;                            // limit of ratio of saturated pixels
+    double maxDark;                                 // limit of ratio of black pixels
+    double referenceSharpness;                      // running average of sharpness
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //FRAME_QUALITY_H
@@ -0,0 +1,89 @@
+/*********************************************************************************************//**
+* @file luma_ingest.h
+*
+* Gray image from raw Bayer and YUV image messages header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef LUMA_INGEST_H
+#define LUMA_INGEST_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standard ROS libraries
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/image_encodings.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Gray image is taken directly from image message without colour conversion
+// Mono8 and Y plane of planar YUV are used without copy, luma of packed YUV is copied,
+// Bayer can be converted to half resolution - every 2x2 cell gives one pixel
+class LumaIngest
+{
+public:
+    enum BayerMode {BAYER_HALF_GREEN, BAYER_HALF_GRAY, BAYER_FULL};
+
+    LumaIngest();
+
+    // Full resolution by cv_bridge, or half resolution from green pixels or from all four pixels of cell
+    void set_bayer_mode(BayerMode mode);
+
+    // Gray image of message, false if encoding is not supported or size of data does not match width, height and step
+    // Conversion by cv_bridge has to be used then
+    // Image can share data with message, it is valid until next call
+    bool ingest(const sensor_msgs::Image &message, cv::Mat &luma);
+
+    // Resolution of last gray image relative to message
+    inline double scale() const
+    {
+        return lastScale;
+    }
+
+private:
+    bool valid_size(const sensor_msgs::Image &message, size_t step, int bytesPerPixel) const;
+    bool packed_yuv(const sensor_msgs::Image &message, int lumaOffset);
+    bool bayer_green(const sensor_msgs::Image &message, int firstGreen);
+    bool bayer_gray(const sensor_msgs::Image &message);
+
+    BayerMode bayerMode;                            // conversion of Bayer images
+    cv::Mat buffer;                                 // gray image, if it is not shared with message
+    double lastScale;                               // resolution of last gray image
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //LUMA_INGEST_H
@@ -0,0 +1,86 @@
+/*********************************************************************************************//**
+* @file marker_id_filter.h
+*
+* Whitelist of accepted ArUco marker IDs header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+#ifndef MARKER_ID_FILTER_H
+#define MARKER_ID_FILTER_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <string>
+#include <vector>
+
+// Aruco libraries
+#include <aruco/aruco.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Marker IDs of ArUco library are in range 0-1023
+#define MARKER_ID_FILTER_SIZE 1024
+// Accepted IDs, if list and file of parameters are wrong
+#define MARKER_ID_FILTER_DEFAULT "0-1023:10"
+
+class MarkerIdFilter
+{
+public:
+    MarkerIdFilter();
+
+    // Accepting of every ID, or of none
+    void accept_all();
+    void reject_all();
+    // Accepting of ranges and explicit IDs, e.g. "0-100,150,200-1023:10" (":10" - every 10th ID)
+    bool accept_list(const std::string &spec);
+    // Accepting of bitset from file, character '1' on position N accepts ID N, '#' starts comment
+    bool load_file(const std::string &filename);
+    // Removing of all not accepted markers, order of remaining markers is kept
+    void filter(std::vector<aruco::Marker> &markers) const;
+    // Only IDs of file, or of list if file is empty, wrong file falls back to list and wrong list to default
+    // False if any fallback was used
+    bool setup(const std::string &spec, const std::string &filename);
+    // Number of accepted IDs
+    int count() const;
+
+    inline bool accepted(int markerID) const
+    {
+        return (markerID>=0)&&(markerID<MARKER_ID_FILTER_SIZE)&&(mask[markerID]!=0);
+    }
+
+private:
+    std::vector<unsigned char> mask;                // sign of acceptance for each ID
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //MARKER_ID_FILTER_H
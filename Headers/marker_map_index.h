@@ -0,0 +1,105 @@
+/*********************************************************************************************//**
+* @file marker_map_index.h
+*
+* Spatial index of mapped ArUco markers header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef MARKER_MAP_INDEX_H
+#define MARKER_MAP_INDEX_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Lookup of mapped markers by ID and by global position
+// Markers are stored in uniform grid of cells, queries visit only cells around queried position
+class MarkerMapIndex
+{
+public:
+    explicit MarkerMapIndex(double paramCellSize=2.0);
+
+    void clear();
+    // ID of marker to index in array of all markers
+    void insert_id(int markerID, int index);
+    // Global position of marker with index in array of all markers
+    void insert_position(int index, double x, double y, double z);
+    // Indexes of markers closer than radius to position
+    void query_radius(double x, double y, double z, double radius, std::vector<int> &indexes) const;
+
+    // Index in array of all markers, -1 for unknown marker
+    inline int find_id(int markerID) const
+    {
+        if((markerID<0)||(markerID>=(int)idTable.size()))
+            return -1;
+        return idTable[markerID];
+    }
+
+    inline int size() const
+    {
+        return numberOfPositions;
+    }
+
+private:
+    typedef struct Entry
+    {
+        int index;                                  // index in array of all markers
+        double x,y,z;                               // global position of marker
+    } Entry;
+
+    inline int cell(double coordinate) const
+    {
+        return (int)std::floor(coordinate/cellSize);
+    }
+
+    inline int64_t cell_key(int cx, int cy, int cz) const
+    {
+        return ((int64_t)(cx&0x1FFFFF)<<42)|((int64_t)(cy&0x1FFFFF)<<21)|(int64_t)(cz&0x1FFFFF);
+    }
+
+    double cellSize;                                // size of cell [m]
+    std::vector<int> idTable;                       // index of marker for each ID
+    std::unordered_map<int64_t,std::vector<Entry> > grid; // cells with markers
+    int numberOfPositions;                          // count of inserted positions
+    int minCell[3];                                 // bounding box of occupied cells
+    int maxCell[3];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //MARKER_MAP_INDEX_H
@@ -0,0 +1,149 @@
+/*********************************************************************************************//**
+* @file marker_map_snapshot.h
+*
+* Immutable versions of marker map shared without locks header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef MARKER_MAP_SNAPSHOT_H
+#define MARKER_MAP_SNAPSHOT_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+// My libraries
+#include <rigid_transform.h>
+#include <marker_map_index.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One version of map, it is never changed after publishing
+typedef struct MarkerMapSnapshot
+{
+    uint64_t version;                               // number of version, increased by every publishing
+    int numberOfMarkers;                            // count of mapped markers
+    std::vector<int> markerIDs;                     // ID of each mapped marker
+    std::vector<int> relatedMarkers;                // index of related marker, -2 for origin
+    RigidTransformArray markerTransforms;           // transform of marker to its related marker
+    RigidTransformArray markerGlobeTransforms;      // transform of marker to world
+    MarkerMapIndex index;                           // lookup of markers by ID and position
+} MarkerMapSnapshot;
+
+// Versions of map with single writer (mapper) and fixed number of readers, nobody waits
+// Reader announces epoch before reading of actual version, old version is deleted by writer
+// when every reader announced later epoch or does not read
+class MarkerMapSnapshots
+{
+public:
+    explicit MarkerMapSnapshots(int paramMaxReaders=8);
+    ~MarkerMapSnapshots();
+
+    // Slot of reader, -1 if all slots are used, each reader thread needs own slot
+    int register_reader();
+    void unregister_reader(int reader);
+    // Actual version, it is valid until release() of the same reader, NULL before first publishing
+    const MarkerMapSnapshot *acquire(int reader) const;
+    void release(int reader) const;
+
+    // New version, snapshot is owned by this object from now, only for writer
+    void publish(MarkerMapSnapshot *snapshot);
+    // Deleting of old versions, which are not read
+    void reclaim();
+
+    // Number of actual version, 0 before first publishing
+    inline uint64_t version() const
+    {
+        return publishedVersion.load(std::memory_order_acquire);
+    }
+
+private:
+    // Epoch of reader in own cache line, 0 if reader does not read
+    // Alignment is kept by own allocation, std::vector does not align over-aligned types before C++17
+    typedef struct alignas(64) ReaderSlot
+    {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> used;
+    } ReaderSlot;
+
+    MarkerMapSnapshots(const MarkerMapSnapshots &);
+    MarkerMapSnapshots &operator=(const MarkerMapSnapshots &);
+
+    int numberOfReaders;                            // count of reader slots
+    char *readerMemory;                             // allocated memory of slots, not aligned
+    ReaderSlot *readers;                            // announced epochs of readers, aligned to cache line
+    std::atomic<uint64_t> globalEpoch;              // increased by every publishing
+    std::atomic<uint64_t> publishedVersion;         // version of actual snapshot
+    std::atomic<const MarkerMapSnapshot*> current;  // actual version
+    std::vector<std::pair<uint64_t,const MarkerMapSnapshot*> > retired; // old versions with epoch of retiring
+};
+
+// Reading of actual version in scope
+class MarkerMapReadGuard
+{
+public:
+    MarkerMapReadGuard(const MarkerMapSnapshots &paramSnapshots, int paramReader) :
+        snapshots(paramSnapshots),
+        reader(paramReader),
+        snapshot(paramSnapshots.acquire(paramReader))
+    {
+    }
+    ~MarkerMapReadGuard()
+    {
+        snapshots.release(reader);
+    }
+
+    inline const MarkerMapSnapshot *get() const
+    {
+        return snapshot;
+    }
+    inline const MarkerMapSnapshot *operator->() const
+    {
+        return snapshot;
+    }
+
+private:
+    MarkerMapReadGuard(const MarkerMapReadGuard &);
+    MarkerMapReadGuard &operator=(const MarkerMapReadGuard &);
+
+    const MarkerMapSnapshots &snapshots;            // versions of map
+    int reader;                                     // slot of reader
+    const MarkerMapSnapshot *snapshot;              // read version
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //MARKER_MAP_SNAPSHOT_H
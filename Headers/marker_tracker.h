@@ -0,0 +1,105 @@
+/*********************************************************************************************//**
+* @file marker_tracker.h
+*
+* Tracking of marker corners by pyramidal optical flow header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef MARKER_TRACKER_H
+#define MARKER_TRACKER_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+
+// Aruco libraries
+#include <aruco/aruco.h>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/video/tracking.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Corners of markers from last full detection are tracked by pyramidal Lucas-Kanade optical flow
+// Tracking fails, if full detection is due, or if corners of any marker do not pass quality checks
+class MarkerTracker
+{
+public:
+    MarkerTracker();
+
+    // Full detection every interval images, interval 1 switches tracking off
+    void set_interval(int paramInterval);
+    // Window and count of levels of pyramid, maximal error of optical flow
+    void set_flow(int window, int levels, double maxError);
+    // Maximal distance of corner tracked forward and back [px], 0 switches backward tracking off
+    void set_backward_threshold(double threshold);
+
+    inline bool enabled() const
+    {
+        return interval>1;
+    }
+
+    // Markers of full detection in actual image, they are tracked in next images
+    void reset(const cv::Mat &image, const std::vector<aruco::Marker> &detected);
+    // Next full detection is done in next image
+    void request_detection();
+    // Tracked markers in actual image, false if full detection has to be done
+    bool track(const cv::Mat &image, std::vector<aruco::Marker> &tracked);
+
+private:
+    void build_pyramid(const cv::Mat &image, std::vector<cv::Mat> &pyramid) const;
+    bool check_marker(const cv::Point2f previous[4], const cv::Point2f actual[4], const cv::Size &size) const;
+
+    int interval;                                   // images between full detections
+    int imagesFromDetection;                        // images tracked from last full detection
+    bool detectionRequested;                        // full detection in next image
+    cv::Size windowSize;                            // window of optical flow
+    int levels;                                     // levels of pyramid
+    double maxError;                                // maximal error of optical flow
+    double backwardThreshold;                       // maximal forward-backward distance [px]
+    std::vector<aruco::Marker> markers;             // markers in previous image
+    std::vector<cv::Mat> previousPyramid;           // pyramid of previous image
+    std::vector<cv::Mat> actualPyramid;             // pyramid of actual image
+    std::vector<cv::Point2f> previousCorners;       // corners of all markers in previous image
+    std::vector<cv::Point2f> actualCorners;         // tracked corners in actual image
+    std::vector<cv::Point2f> backwardCorners;       // corners tracked back to previous image
+    std::vector<uchar> status;                      // status of optical flow
+    std::vector<uchar> backwardStatus;              // status of backward optical flow
+    std::vector<float> errors;                      // errors of optical flow
+    std::vector<float> backwardErrors;              // errors of backward optical flow
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //MARKER_TRACKER_H
@@ -0,0 +1,102 @@
+/*********************************************************************************************//**
+* @file planar_pose_solver.h
+*
+* Batched closed form pose solver of square planar markers header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef PLANAR_POSE_SOLVER_H
+#define PLANAR_POSE_SOLVER_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+
+// Aruco libraries
+#include <aruco/aruco.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Pose of marker in camera frame, same convention as Rvec and Tvec of aruco::Marker - Y is perpendicular to marker
+typedef struct MarkerPose
+{
+    double R[9];                                    // rotation matrix, row major
+    double t[3];                                    // translation [m]
+    double error;                                   // RMS reprojection error [px]
+    bool valid;                                     // sign of successful solution
+} MarkerPose;
+
+// Pose of all markers in image is solved at once by IPPE (Infinitesimal Plane-based Pose Estimation)
+// Two solutions of planar pose are resolved by reprojection error and by pose of marker in previous image
+class PlanarPoseSolver
+{
+public:
+    PlanarPoseSolver();
+
+    // Intrinsics fx, fy, cx, cy and distortion k1, k2, p1, p2, k3
+    void set_camera(const double cameraMatrix[4], const double distortion[5]);
+    void set_marker_size(double paramMarkerSize);
+    // Solution is ambiguous, if reprojection errors differ less than this ratio
+    void set_ambiguity_ratio(double ratio);
+    // Previous rotation of marker is used only if marker was solved at most this count of images ago
+    void set_previous_max_age(int images);
+
+    // Poses of all markers of one image, poses are written to preallocated array
+    void solve(const std::vector<aruco::Marker> &markers, std::vector<MarkerPose> &poses);
+    // Pose of one marker from its four corners
+    bool solve_marker(int markerID, const cv::Point2f corners[4], MarkerPose &pose);
+
+    // Rotation matrix to rotation vector (Rodrigues)
+    static void rotation_to_rvec(const double R[9], double rvec[3]);
+
+private:
+    void undistort(const cv::Point2f &pixel, double &x, double &y) const;
+    bool homography(const double x[4], const double y[4], double H[9]) const;
+    void rotations(const double H[9], double R1[9], double R2[9]) const;
+    void translation(const double R[9], const double x[4], const double y[4], double t[3]) const;
+    double reprojection_error(const double R[9], const double t[3], const double x[4], const double y[4]) const;
+
+    double fx,fy,cx,cy;                             // camera intrinsics
+    double k1,k2,p1,p2,k3;                          // camera distortion
+    double markerSize;                              // size of marker [m]
+    double objectX[4],objectY[4];                   // corners of marker in marker frame
+    double ambiguityRatio;                          // ratio of reprojection errors of ambiguous solutions
+    int previousMaxAge;                             // maximal age of previous rotation [images]
+    unsigned int imageCounter;                      // number of actual image
+    std::vector<double> previousRotation;           // rotation of each marker ID in previous solution
+    std::vector<unsigned int> previousImage;        // number of image of previous rotation, 0 if none
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //PLANAR_POSE_SOLVER_H
@@ -0,0 +1,103 @@
+/*********************************************************************************************//**
+* @file pose_history.h
+*
+* Ring buffer of global positions with interpolation in time header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef POSE_HISTORY_H
+#define POSE_HISTORY_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+// My libraries
+#include <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Maximal count of repeated search, writer overwrites oldest positions during search
+#define POSE_HISTORY_MAX_RETRIES 4
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Global position in time
+typedef struct PoseHistoryEntry
+{
+    uint64_t stamp;                                 // time [ns]
+    double position[3];                             // x, y, z
+    double orientation[4];                          // x, y, z, w
+} PoseHistoryEntry;
+
+// Fixed number of last global positions, single writer and any number of readers without locks
+// Each slot is protected by sequence lock, reader repeats reading of slot changed during reading
+class PoseHistory
+{
+public:
+    // Positions are not interpolated over gap larger than paramMaxGap [ns], 0 means any gap
+    explicit PoseHistory(size_t paramCapacity=1000, uint64_t paramMaxGap=0);
+
+    // New position, times have to increase, older positions are ignored
+    void push(uint64_t stamp, const RigidTransform &transform);
+    // Position interpolated to given time, false if time is out of history or in too large gap between positions
+    bool query(uint64_t stamp, PoseHistoryEntry &entry) const;
+    // Count of stored positions
+    size_t size() const;
+
+private:
+    enum SearchResult {SEARCH_FOUND, SEARCH_OUT, SEARCH_OVERWRITTEN};
+
+    typedef struct Slot
+    {
+        std::atomic<uint32_t> sequence;             // odd during writing
+        uint64_t index;                             // number of position since start
+        PoseHistoryEntry entry;                     // position
+    } Slot;
+
+    bool read_slot(uint64_t index, PoseHistoryEntry &entry) const;
+    // Positions around given time, second is equal to first if time is exactly at first
+    SearchResult search(uint64_t stamp, PoseHistoryEntry &first, PoseHistoryEntry &second) const;
+
+    size_t capacity;                                // count of slots
+    uint64_t maxGap;                                // maximal time between interpolated positions [ns]
+    std::vector<Slot> slots;                        // ring buffer
+    std::atomic<uint64_t> written;                  // count of written positions
+    uint64_t lastStamp;                             // time of last position, only for writer
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //POSE_HISTORY_H
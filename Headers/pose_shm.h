@@ -0,0 +1,255 @@
+/*********************************************************************************************//**
+* @file pose_shm.h
+*
+* Shared memory output of ArUco Positioning System, header only writer and reader
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+#ifndef POSE_SHM_H
+#define POSE_SHM_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Only standard C++11 and POSIX libraries, reader does not depend on ROS
+#include <atomic>
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Layout identification, version is changed with every change of layout
+#define POSE_SHM_MAGIC 0x41505331
+#define POSE_SHM_VERSION 1
+// Maximal number of visible markers in one frame
+#define POSE_SHM_MAX_MARKERS 64
+// Maximal count of repeated reading, writer can be dead in the middle of writing
+#define POSE_SHM_MAX_RETRIES 10000
+
+// Pose in the same order as geometry_msgs::Pose
+typedef struct PoseShmPose
+{
+    double position[3];                             // x, y, z
+    double orientation[4];                          // x, y, z, w
+} PoseShmPose;
+
+typedef struct PoseShmMarker
+{
+    int32_t markerID;                               // ID of marker
+    int32_t reserved;
+    PoseShmPose markerPose;                         // global position of marker
+    PoseShmPose cameraPose;                         // position of camera to marker
+} PoseShmMarker;
+
+// Content of ArUcoMarkersPose message
+typedef struct PoseShmData
+{
+    uint64_t stamp;                                 // time of image [ns]
+    int32_t visibility;                             // sign of visibility of any marker
+    int32_t numberOfMarkers;                        // number of visible markers
+    PoseShmPose globalPose;                         // global position of camera
+    PoseShmMarker markers[POSE_SHM_MAX_MARKERS];    // visible markers
+} PoseShmData;
+
+// Segment of shared memory, data are protected by sequence lock
+typedef struct PoseShmSegment
+{
+    uint32_t magic;                                 // POSE_SHM_MAGIC
+    uint32_t version;                               // POSE_SHM_VERSION
+    std::atomic<uint32_t> sequence;                 // odd during writing
+    uint32_t reserved;
+    PoseShmData data;
+} PoseShmSegment;
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Single writer, it never waits for readers
+class PoseShmWriter
+{
+public:
+    PoseShmWriter() : segment(NULL) {}
+    ~PoseShmWriter() { close(); }
+
+    // Creating of segment, name has form "/name"
+    // Only owner writes by default, mode is set also for existing segment and umask is not applied
+    inline bool open(const std::string &name, mode_t mode=0644)
+    {
+        close();
+        int fd=shm_open(name.c_str(),O_CREAT|O_RDWR,mode);
+        if(fd<0)
+            return false;
+        if((fchmod(fd,mode)!=0)||(ftruncate(fd,sizeof(PoseShmSegment))!=0))
+        {
+            ::close(fd);
+            return false;
+        }
+        void *memory=mmap(NULL,sizeof(PoseShmSegment),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        ::close(fd);
+        if(memory==MAP_FAILED)
+            return false;
+
+        // Segment can be already mapped by readers, sequence continues from its last value
+        // Data are cleared as one writing, readers see change of sequence
+        segment=static_cast<PoseShmSegment*>(memory);
+        const uint32_t sequence=segment->sequence.load(std::memory_order_relaxed)|1;
+        segment->sequence.store(sequence,std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memset(&segment->data,0,sizeof(PoseShmData));
+        segment->version=POSE_SHM_VERSION;
+        segment->sequence.store(sequence+1,std::memory_order_release);
+        segment->magic=POSE_SHM_MAGIC;
+        return true;
+    }
+
+    inline void close()
+    {
+        if(segment!=NULL)
+            munmap(segment,sizeof(PoseShmSegment));
+        segment=NULL;
+    }
+
+    inline bool is_open() const
+    {
+        return segment!=NULL;
+    }
+
+    // Data are written directly to segment between begin_write() and end_write()
+    inline PoseShmData &begin_write()
+    {
+        const uint32_t sequence=segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence+1,std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return segment->data;
+    }
+
+    inline void end_write()
+    {
+        const uint32_t sequence=segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence+1,std::memory_order_release);
+    }
+
+private:
+    PoseShmSegment *segment;                        // mapped shared memory
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Any number of readers, reading is repeated if writer changed data during reading
+class PoseShmReader
+{
+public:
+    PoseShmReader() : segment(NULL) {}
+    ~PoseShmReader() { close(); }
+
+    // Opening of existing segment, name has form "/name"
+    inline bool open(const std::string &name)
+    {
+        close();
+        int fd=shm_open(name.c_str(),O_RDONLY,0);
+        if(fd<0)
+            return false;
+        void *memory=mmap(NULL,sizeof(PoseShmSegment),PROT_READ,MAP_SHARED,fd,0);
+        ::close(fd);
+        if(memory==MAP_FAILED)
+            return false;
+
+        segment=static_cast<const PoseShmSegment*>(memory);
+        if((segment->magic!=POSE_SHM_MAGIC)||(segment->version!=POSE_SHM_VERSION))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    inline void close()
+    {
+        if(segment!=NULL)
+            munmap(const_cast<PoseShmSegment*>(segment),sizeof(PoseShmSegment));
+        segment=NULL;
+    }
+
+    inline bool is_open() const
+    {
+        return segment!=NULL;
+    }
+
+    // Sequence number is changed with every new data, it can be used for polling
+    inline uint32_t sequence() const
+    {
+        return segment->sequence.load(std::memory_order_acquire);
+    }
+
+    // Copy of all data, false if consistent data were not read in POSE_SHM_MAX_RETRIES attempts
+    // Sequence number of read data is optional output
+    inline bool read(PoseShmData &data, uint32_t *sequence=NULL) const
+    {
+        return read_bytes(&data,sizeof(PoseShmData),sequence);
+    }
+
+    // Copy of stamp, visibility and global position only, markers are not copied
+    inline bool read_global_pose(PoseShmData &data, uint32_t *sequence=NULL) const
+    {
+        return read_bytes(&data,offsetof(PoseShmData,markers),sequence);
+    }
+
+private:
+    inline bool read_bytes(void *destination, size_t size, uint32_t *sequence) const
+    {
+        for(int attempt=0;attempt<POSE_SHM_MAX_RETRIES;attempt++)
+        {
+            const uint32_t before=segment->sequence.load(std::memory_order_acquire);
+            if((before&1)!=0)
+                continue;
+            std::memcpy(destination,&segment->data,size);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t after=segment->sequence.load(std::memory_order_relaxed);
+            if(before==after)
+            {
+                if(sequence!=NULL)
+                    *sequence=after;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const PoseShmSegment *segment;                  // mapped shared memory
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //POSE_SHM_H
@@ -0,0 +1,122 @@
+/*********************************************************************************************//**
+* @file rigid_transform.h
+*
+* Fixed size rigid transforms and batched operations over structure of arrays header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef RIGID_TRANSFORM_H
+#define RIGID_TRANSFORM_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+#include <cstddef>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Rigid transform, point in child frame is transformed to parent frame as R*p+t
+typedef struct RigidTransform
+{
+    double R[9];                                    // rotation matrix, row major
+    double t[3];                                    // translation
+} RigidTransform;
+
+// Identity transform
+void rigid_identity(RigidTransform &T);
+// Composition C=A*B, C must not be A or B
+void rigid_compose(const RigidTransform &A, const RigidTransform &B, RigidTransform &C);
+// Inverse B=A^-1, B must not be A
+void rigid_invert(const RigidTransform &A, RigidTransform &B);
+// Conversion from and to quaternion x, y, z, w
+void rigid_from_quaternion(const double q[4], const double t[3], RigidTransform &T);
+void rigid_to_quaternion(const RigidTransform &T, double q[4]);
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Transform in the plane Z=0, rotation only around Z axis
+typedef struct PlanarTransform
+{
+    double x,y;                                     // translation
+    double yaw;                                     // rotation around Z [rad]
+} PlanarTransform;
+
+// Composition C=A*B, C must not be A or B
+void planar_compose(const PlanarTransform &A, const PlanarTransform &B, PlanarTransform &C);
+// Projection of rigid transform to the plane, roll, pitch and Z are dropped
+void planar_from_rigid(const RigidTransform &T, PlanarTransform &P);
+// Rigid transform of planar transform
+void rigid_from_planar(const PlanarTransform &P, RigidTransform &T);
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Array of transforms stored as structure of arrays, each element of matrix and vector in own array
+// Batched operations are simple loops over contiguous arrays, compiler can vectorize them
+class RigidTransformArray
+{
+public:
+    explicit RigidTransformArray(size_t count=0);
+
+    // Changing of count, capacity is kept and it does not allocate under reserved capacity
+    void resize(size_t count);
+    void reserve(size_t count);
+    inline size_t size() const
+    {
+        return t[0].size();
+    }
+
+    // Access to one transform
+    void set(size_t i, const RigidTransform &T);
+    void get(size_t i, RigidTransform &T) const;
+    inline const double *translation(int axis) const
+    {
+        return &t[axis][0];
+    }
+
+    // Every transform is inverted
+    void invert();
+    // Every transform is composed with transform of other array with same size, this[i]=left[i]*this[i]
+    void compose_left(const RigidTransformArray &left);
+    // this[i]=source[indexes[i]]
+    void gather(const RigidTransformArray &source, const std::vector<int> &indexes);
+    // destination[indexes[i]]=this[i]
+    void scatter(const std::vector<int> &indexes, RigidTransformArray &destination) const;
+
+private:
+    std::vector<double> R[9];                       // elements of rotation matrices
+    std::vector<double> t[3];                       // elements of translations
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //RIGID_TRANSFORM_H
@@ -0,0 +1,120 @@
+/*********************************************************************************************//**
+* @file space_model.h
+*
+* Policies of marker space - 3D space or plane, header only
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef SPACE_MODEL_H
+#define SPACE_MODEL_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <cmath>
+
+// My libraries
+#include <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Space model is template parameter of mapping, every policy has:
+// Pose - type of marker pose in map
+// load() - pose of stored transform, lift() - transform of pose for storing and publishing
+// relative() - pose of new marker to old marker from camera over old marker and new marker in camera frame,
+//              false if the pose does not fit the space model
+// compose() - global pose of new marker from global pose of old marker and relative pose
+
+// Markers anywhere in 3D space, full 6-DOF transforms
+struct Space3D
+{
+    typedef RigidTransform Pose;
+
+    static inline void load(const RigidTransform &transform, Pose &pose)
+    {
+        pose=transform;
+    }
+    static inline void lift(const Pose &pose, RigidTransform &transform)
+    {
+        transform=pose;
+    }
+    static inline bool relative(const RigidTransform &oldCamera, const RigidTransform &newMarker, Pose &pose)
+    {
+        rigid_compose(oldCamera,newMarker,pose);
+        return true;
+    }
+    static inline void compose(const Pose &oldGlobe, const Pose &relative, Pose &globe)
+    {
+        rigid_compose(oldGlobe,relative,globe);
+    }
+};
+
+// All markers in the plane Z=0, 3-DOF transforms (x, y, yaw), roll, pitch and Z are zero by definition
+// Only relative pose is measured in 3D, map is composed in the plane and lifted to 3D for publishing
+// Z of marker frame is normal of the plane, markers with normals far from each other are not in one plane
+struct SpacePlane
+{
+    typedef PlanarTransform Pose;
+
+    // Minimal |cos| of angle between normals of old and new marker (about 25 deg)
+    static constexpr double minNormalCosine=0.9;
+
+    static inline void load(const RigidTransform &transform, Pose &pose)
+    {
+        planar_from_rigid(transform,pose);
+    }
+    static inline void lift(const Pose &pose, RigidTransform &transform)
+    {
+        rigid_from_planar(pose,transform);
+    }
+    static inline bool relative(const RigidTransform &oldCamera, const RigidTransform &newMarker, Pose &pose)
+    {
+        // Only first two rows of composition are needed, r22 only checks normals
+        const double *A=oldCamera.R;
+        const double *B=newMarker.R;
+        const double r00=A[0]*B[0]+A[1]*B[3]+A[2]*B[6];
+        const double r10=A[3]*B[0]+A[4]*B[3]+A[5]*B[6];
+        const double r22=A[6]*B[2]+A[7]*B[5]+A[8]*B[8];
+        pose.x=A[0]*newMarker.t[0]+A[1]*newMarker.t[1]+A[2]*newMarker.t[2]+oldCamera.t[0];
+        pose.y=A[3]*newMarker.t[0]+A[4]*newMarker.t[1]+A[5]*newMarker.t[2]+oldCamera.t[1];
+        pose.yaw=std::atan2(r10,r00);
+        return std::fabs(r22)>=minNormalCosine;
+    }
+    static inline void compose(const Pose &oldGlobe, const Pose &relative, Pose &globe)
+    {
+        planar_compose(oldGlobe,relative,globe);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //SPACE_MODEL_H
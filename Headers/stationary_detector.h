@@ -0,0 +1,96 @@
+/*********************************************************************************************//**
+* @file stationary_detector.h
+*
+* Detection of unchanged scene by difference of subsampled images header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef STATIONARY_DETECTOR_H
+#define STATIONARY_DETECTOR_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Scene is stationary, if image differs from reference image only in few pixels of subsampled grid
+// Reference is image of last motion, so slow motion is detected after it is accumulated
+class StationaryDetector
+{
+public:
+    StationaryDetector();
+
+    // Pixel changed more than threshold is changed, threshold 0 switches detection off
+    void set_threshold(int paramThreshold);
+    // Distance of compared pixels in both directions
+    void set_step(int paramStep);
+    // Scene is changed, if ratio of changed pixels is higher
+    void set_max_changed(double paramMaxChanged);
+    // Count of images without change, before scene is stationary
+    void set_hold(int paramHold);
+
+    // Comparing of Mono8 image with reference, true if scene is stationary
+    bool update(const cv::Mat &image);
+    // Next image is taken as reference
+    void reset();
+
+    inline bool enabled() const
+    {
+        return threshold>0;
+    }
+    inline int stationary_frames() const
+    {
+        return stillFrames;
+    }
+
+private:
+    int sample(const cv::Mat &image);
+
+    int threshold;                                  // intensity difference of changed pixel
+    int step;                                       // distance of compared pixels
+    double maxChanged;                              // limit of ratio of changed pixels
+    int hold;                                       // images without change before stationary scene
+    int stillFrames;                                // count of images without change
+    cv::Size referenceSize;                         // size of reference image, empty if no reference
+    std::vector<unsigned char> reference;           // pixels of grid of reference image
+    std::vector<unsigned char> current;             // pixels of grid of actual image
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //STATIONARY_DETECTOR_H
@@ -0,0 +1,108 @@
+/*********************************************************************************************//**
+* @file synthetic_scene.h
+*
+* Synthetic images of marker field with known ground truth header file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Standarc C++ libraries
+#include <vector>
+
+// OpenCV libraries
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/core.hpp>
+
+// My libraries
+#include <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Marker of scene, pose is in frame of PlanarPoseSolver (corners (-s/2,-s/2), (-s/2,s/2), (s/2,s/2), (s/2,-s/2))
+typedef struct SyntheticMarker
+{
+    int markerID;                                   // ID of marker
+    RigidTransform pose;                            // marker to world
+} SyntheticMarker;
+
+// Field of markers rendered through pinhole camera with distortion
+// First marker is in origin of world, it has to have the lowest ID - it is origin of map of estimator
+class SyntheticScene
+{
+public:
+    SyntheticScene();
+
+    // Camera model in the same form as calibration file - 3x3 intrinsics and 5x1 distortion
+    void set_camera(const cv::Mat &cameraMatrix, const cv::Mat &distortion, cv::Size paramImageSize);
+    void set_marker_size(double paramMarkerSize);
+    // Gaussian blur and gaussian noise of rendered image, zero switches them off
+    void set_blur(double sigma);
+    void set_noise(double sigma);
+
+    // Grid of markers with given spacing [m], in 3D space markers have random height and tilt
+    void generate(const std::vector<int> &markerIDs, double spacing, bool space3D, unsigned int seed);
+    // Mono8 image from camera with pose camera to world, camera frame has X right, Y down and Z forward
+    void render(const RigidTransform &camera, cv::Mat &image);
+    // Camera pose in world frame of estimator, which is ROS frame of first marker
+    void ground_truth(const RigidTransform &camera, RigidTransform &position) const;
+
+    inline size_t size() const
+    {
+        return sceneMarkers.size();
+    }
+    inline const SyntheticMarker &marker(size_t i) const
+    {
+        return sceneMarkers[i];
+    }
+
+private:
+    std::vector<SyntheticMarker> sceneMarkers;      // markers of scene
+    std::vector<cv::Mat> markerImages;              // images of markers, black border included
+    cv::Mat cameraMatrix;                           // camera intrinsics
+    cv::Mat distortion;                             // camera distortion
+    cv::Size imageSize;                             // size of rendered image
+    double markerSize;                              // size of marker [m]
+    double blurSigma;                               // gaussian blur of image [px]
+    double noiseSigma;                              // gaussian noise of image [gray levels]
+    cv::RNG rng;                                    // random generator of scene and noise
+    std::vector<cv::Point3f> cornersCamera;         // corners of marker in camera frame
+    std::vector<cv::Point2f> cornersImage;          // projected corners of marker
+    cv::Mat noise;                                  // noise image
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif //SYNTHETIC_SCENE_H
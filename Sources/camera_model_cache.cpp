@@ -0,0 +1,119 @@
+/*********************************************************************************************//**
+* @file camera_model_cache.cpp
+*
+* Camera parameters of scaled and cropped images source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <camera_model_cache.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+CameraModelCache::Key::operator<(const Key &other) const
+{
+    if(scaleX!=other.scaleX)
+        return scaleX<other.scaleX;
+    if(scaleY!=other.scaleY)
+        return scaleY<other.scaleY;
+    if(x!=other.x)
+        return x<other.x;
+    if(y!=other.y)
+        return y<other.y;
+    if(width!=other.width)
+        return width<other.width;
+    return height<other.height;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+CameraModelCache::CameraModelCache(size_t paramMaxModels) :
+    maxModels((paramMaxModels>0)?paramMaxModels:1)       // at least actual configuration
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+CameraModelCache::set_calibration(const cv::Mat &paramIntrinsics, const cv::Mat &paramDistortion, const cv::Size &paramSize)
+{
+    intrinsics=paramIntrinsics.clone();
+    distortion=paramDistortion.clone();
+    imageSize=paramSize;
+    models.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+cv::Point2d
+CameraModelCache::scale_of_size(const cv::Size &size, double defaultScale) const
+{
+    if((imageSize.width<=0)||(imageSize.height<=0)||(size.width<=0)||(size.height<=0))
+        return cv::Point2d(defaultScale,defaultScale);
+    return cv::Point2d((double)size.width/imageSize.width,(double)size.height/imageSize.height);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+const CameraModel &
+CameraModelCache::model(const cv::Point2d &scale, const cv::Rect &crop)
+{
+    const Key key={scale.x,scale.y,crop.x,crop.y,crop.width,crop.height};
+    std::map<Key,CameraModel>::const_iterator found=models.find(key);
+    if(found!=models.end())
+        return found->second;
+
+    // Configuration is changed rarely, many configurations mean changes at runtime
+    if(models.size()>=maxModels)
+        models.clear();
+
+    // Centre of pixel is kept by scaling, principal point is moved by origin of crop
+    // fx and cx follow scale of x, fy and cy scale of y
+    // Distortion does not depend on resolution
+    CameraModel &entry=models[key];
+    cv::Mat scaledIntrinsics=intrinsics.clone();
+    scaledIntrinsics.at<double>(0,0)=intrinsics.at<double>(0,0)*scale.x;
+    scaledIntrinsics.at<double>(1,1)=intrinsics.at<double>(1,1)*scale.y;
+    scaledIntrinsics.at<double>(0,2)=(intrinsics.at<double>(0,2)+0.5)*scale.x-0.5-crop.x;
+    scaledIntrinsics.at<double>(1,2)=(intrinsics.at<double>(1,2)+0.5)*scale.y-0.5-crop.y;
+    entry.parameters.setParams(scaledIntrinsics,distortion,crop.size());
+
+    entry.cameraMatrix[0]=scaledIntrinsics.at<double>(0,0);
+    entry.cameraMatrix[1]=scaledIntrinsics.at<double>(1,1);
+    entry.cameraMatrix[2]=scaledIntrinsics.at<double>(0,2);
+    entry.cameraMatrix[3]=scaledIntrinsics.at<double>(1,2);
+    for(int i=0;i<5;i++)
+        entry.distortion[i]=distortion.at<double>(i,0);
+    return entry;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,171 @@
+/*********************************************************************************************//**
+* @file dataset_reader.cpp
+*
+* Reader of recorded images from bag file or video source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <dataset_reader.h>
+
+// Standarc C++ libraries
+#include <iostream>
+
+// Standard ROS libraries
+
+// OpenCV libraries
+#include <opencv2/imgproc/imgproc.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+DatasetReader::DatasetReader() :
+    isBag(false),                                        // video by default
+    view(NULL),                                          // no bag file
+    frameCounter(0),                                     // no frame
+    videoFps(30)                                         // if video does not know its FPS
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+DatasetReader::~DatasetReader()
+{
+    close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+DatasetReader::open(const std::string &filename, const std::string &topic)
+{
+    close();
+
+    const std::string bagSuffix(".bag");
+    isBag=(filename.size()>=bagSuffix.size())&&(filename.compare(filename.size()-bagSuffix.size(),bagSuffix.size(),bagSuffix)==0);
+
+    if(isBag==true)
+    {
+        try
+        {
+            bag.open(filename,rosbag::bagmode::Read);
+        }
+        catch(rosbag::BagException &ex)
+        {
+            std::cout << "Bag file can not be opened: " << filename << std::endl;
+            return false;
+        }
+        view=new rosbag::View(bag,rosbag::TopicQuery(topic));
+        viewIterator=view->begin();
+        std::cout << "Bag file: " << filename << ", topic: " << topic << ", images: " << view->size() << std::endl;
+        return true;
+    }
+
+    if(video.open(filename)==false)
+    {
+        std::cout << "Video can not be opened: " << filename << std::endl;
+        return false;
+    }
+    frameCounter=0;
+    if(video.get(CV_CAP_PROP_FPS)>0)
+        videoFps=video.get(CV_CAP_PROP_FPS);
+    std::cout << "Video: " << filename << ", frames: " << video.get(CV_CAP_PROP_FRAME_COUNT) << std::endl;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+DatasetReader::close()
+{
+    if(view!=NULL)
+    {
+        delete view;
+        view=NULL;
+        bag.close();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+DatasetReader::read(sensor_msgs::ImageConstPtr &message, cv::Mat &image, ros::Time &stamp)
+{
+    if(isBag==true)
+        return read_bag(message,stamp);
+    message.reset();
+    return read_video(image,stamp);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+DatasetReader::read_bag(sensor_msgs::ImageConstPtr &message, ros::Time &stamp)
+{
+    if(view==NULL)
+        return false;
+
+    // Messages of other types are skipped, image is converted by estimator like in node
+    while(viewIterator!=view->end())
+    {
+        message=viewIterator->instantiate<sensor_msgs::Image>();
+        ++viewIterator;
+        if(!message)
+            continue;
+        stamp=message->header.stamp;
+        return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+DatasetReader::read_video(cv::Mat &image, ros::Time &stamp)
+{
+    if(video.read(frame)==false)
+        return false;
+
+    if(frame.channels()==1)
+        frame.copyTo(image);
+    else
+        cv::cvtColor(frame,image,CV_BGR2GRAY);
+
+    // Time of frame from video, or from count of frames if video does not know it
+    const double milliseconds=video.get(CV_CAP_PROP_POS_MSEC);
+    if((milliseconds>0)||(frameCounter==0))
+        stamp=ros::Time(milliseconds/1000.0);
+    else
+        stamp=ros::Time(frameCounter/videoFps);
+    frameCounter++;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
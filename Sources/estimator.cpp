@@ -46,12 +46,24 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ViewPoint_Estimator::ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMakerSize) :
     markerSize(paramMakerSize),                          // Marker size in m
     filename("empty"),                                   // Initial filenames
-    myListener (new tf::TransformListener),              // Listener of TFs
     regionOfInterest (false),                            // switiching ROI
     numberOfAllMarkers (35),                             // Number of used markers
     StartNow (false),                                    // switching when start image processing
     StartNowFromParameter (false),                       // switching when start image processing
-    type_of_space ("plane")                              // default space - plane
+    type_of_space ("plane"),                             // default space - plane
+    spaceModel (SPACE_PLANE),                            // resolved from type_of_space
+    showImage (true),                                    // window with detected markers
+    worldFrameName ("world"),                            // name of world TF
+    globalPositionFrameName ("myGlobalPosition"),        // name of global position TF
+    tfWholeMap (true),                                   // TFs of whole map with every image
+    tfNeighbourRadius (3.0),                             // radius of published neighbourhood in m
+    tfMapSlice (20),                                     // count of other published markers
+    tfMapSliceStart (0),                                 // first marker of published part of map
+    frameQualityMode (QUALITY_MAPPING),                  // bad images do not add new markers
+    badFrames (0),                                       // count of bad images
+    cameraScale (1.0,1.0),                               // full resolution of camera
+    stationaryDuty (10),                                 // every 10th image of stationary scene
+    stationarySkipped (false)                            // no skipped image
 {
     // Path to calibration file of camera
     //--------------------------------------------------
@@ -71,6 +83,89 @@ ViewPoint_Estimator::ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMak
     //--------------------------------------------------
     // Parameter - type of space, plane or 3D space
     myNode->getParam("type_of_markers_space",type_of_space);
+    spaceModel=(type_of_space=="plane")?SPACE_PLANE:SPACE_3D;
+    //--------------------------------------------------
+    // Parameter - showing of image with detected markers
+    myNode->getParam("show_image",showImage);
+    //--------------------------------------------------
+    // Parameter - spatial index of map and published TFs of not visible markers
+    //--------------------------------------------------
+    double mapIndexCellSize=2.0;
+    myNode->getParam("map_index_cell_size",mapIndexCellSize);
+    markerMapIndex=MarkerMapIndex(mapIndexCellSize);
+    myNode->getParam("tf_whole_map",tfWholeMap);
+    myNode->getParam("tf_neighbour_radius",tfNeighbourRadius);
+    myNode->getParam("tf_map_slice",tfMapSlice);
+    //--------------------------------------------------
+    // Parameter - quality of images, bad images are not detected (skip) or do not add new markers (mapping)
+    //--------------------------------------------------
+    std::string frameQuality("mapping");
+    int frameQualityStep=4;
+    double minSharpness=0,sharpnessRatio=0.5,maxSaturated=0.2,maxDark=0.5;
+    myNode->getParam("frame_quality_gate",frameQuality);
+    myNode->getParam("frame_quality_step",frameQualityStep);
+    myNode->getParam("frame_quality_min_sharpness",minSharpness);
+    myNode->getParam("frame_quality_sharpness_ratio",sharpnessRatio);
+    myNode->getParam("frame_quality_max_saturated",maxSaturated);
+    myNode->getParam("frame_quality_max_dark",maxDark);
+    if(frameQuality=="off")
+        frameQualityMode=QUALITY_OFF;
+    else if(frameQuality=="skip")
+        frameQualityMode=QUALITY_SKIP;
+    else
+        frameQualityMode=QUALITY_MAPPING;
+    frameQualityGate.set_step(frameQualityStep);
+    frameQualityGate.set_limits(minSharpness,sharpnessRatio,maxSaturated,maxDark);
+    //--------------------------------------------------
+    // Parameter - tracking of markers by optical flow between full detections
+    //--------------------------------------------------
+    int trackingInterval=1,trackingWindow=21,trackingLevels=3;
+    double trackingMaxError=20.0,trackingBackwardThreshold=1.0;
+    myNode->getParam("tracking_interval",trackingInterval);
+    myNode->getParam("tracking_window",trackingWindow);
+    myNode->getParam("tracking_levels",trackingLevels);
+    myNode->getParam("tracking_max_error",trackingMaxError);
+    myNode->getParam("tracking_backward_threshold",trackingBackwardThreshold);
+    markerTracker.set_interval(trackingInterval);
+    markerTracker.set_flow(trackingWindow,trackingLevels,trackingMaxError);
+    markerTracker.set_backward_threshold(trackingBackwardThreshold);
+    //--------------------------------------------------
+    // Parameter - stationary scene, previous position is published again without processing
+    //--------------------------------------------------
+    int stationaryThreshold=0,stationaryStep=8,stationaryHold=5;
+    double stationaryMaxChanged=0.01;
+    myNode->getParam("stationary_threshold",stationaryThreshold);
+    myNode->getParam("stationary_step",stationaryStep);
+    myNode->getParam("stationary_max_changed",stationaryMaxChanged);
+    myNode->getParam("stationary_hold",stationaryHold);
+    myNode->getParam("stationary_duty",stationaryDuty);
+    stationaryDetector.set_threshold(stationaryThreshold);
+    stationaryDetector.set_step(stationaryStep);
+    stationaryDetector.set_max_changed(stationaryMaxChanged);
+    stationaryDetector.set_hold(stationaryHold);
+    if(stationaryDuty<1)
+        stationaryDuty=1;
+    //--------------------------------------------------
+    // Parameter - gray image from Bayer, half resolution from green or all pixels of cell, or full resolution
+    //--------------------------------------------------
+    std::string bayerIngest("full");
+    myNode->getParam("bayer_ingest",bayerIngest);
+    if(bayerIngest=="half_gray")
+        lumaIngest.set_bayer_mode(LumaIngest::BAYER_HALF_GRAY);
+    else if(bayerIngest=="half_green")
+        lumaIngest.set_bayer_mode(LumaIngest::BAYER_HALF_GREEN);
+    else
+        lumaIngest.set_bayer_mode(LumaIngest::BAYER_FULL);
+    //--------------------------------------------------
+    // Parameter - ratio of reprojection errors, when two planar solutions are ambiguous
+    //--------------------------------------------------
+    double poseAmbiguityRatio=1.5;
+    int poseAmbiguityMaxAge=5;
+    myNode->getParam("pose_ambiguity_ratio",poseAmbiguityRatio);
+    myNode->getParam("pose_ambiguity_max_age",poseAmbiguityMaxAge);
+    poseSolver.set_ambiguity_ratio(poseAmbiguityRatio);
+    poseSolver.set_previous_max_age(poseAmbiguityMaxAge);
+    poseSolver.set_marker_size(markerSize);
     //--------------------------------------------------
     // Parameter - region of interest - parameters
     //--------------------------------------------------
@@ -83,10 +178,50 @@ ViewPoint_Estimator::ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMak
     myNode->getParam("region_of_interest_width",ROIw);
     myNode->getParam("region_of_interest_height",ROIh);
     //--------------------------------------------------
+    // Parameter - accepted marker IDs, list of ranges or bitset file
+    //--------------------------------------------------
+    std::string markersIdFilter(MARKER_ID_FILTER_DEFAULT);
+    std::string markersIdFilterFile("");
+    myNode->getParam("markers_id_filter",markersIdFilter);
+    myNode->getParam("markers_id_filter_file",markersIdFilterFile);
+    if(markerIdFilter.setup(markersIdFilter,markersIdFilterFile)==false)
+        ROS_WARN("Marker ID filter can not be used as configured, fallback IDs are accepted");
+    std::cout << "Number of accepted marker IDs: " << markerIdFilter.count() << std::endl;
+    //--------------------------------------------------
+    // Parameter - name of shared memory output, empty name switches it off
+    //--------------------------------------------------
+    std::string sharedMemoryName("");
+    int sharedMemoryMode=0644;
+    myNode->getParam("shared_memory_name",sharedMemoryName);
+    myNode->getParam("shared_memory_mode",sharedMemoryMode);
+    if(sharedMemoryName.empty()==false)
+    {
+        if(poseShm.open(sharedMemoryName,(mode_t)(sharedMemoryMode&0666))==true)
+            std::cout << "Shared memory output: " << sharedMemoryName << std::endl;
+        else
+            ROS_ERROR("Shared memory %s can not be created", sharedMemoryName.c_str());
+    }
+    //--------------------------------------------------
+
+    // Parameter - count of global positions in history and maximal interpolated gap between them
+    //--------------------------------------------------
+    int poseHistorySize=1000;
+    double poseHistoryMaxGap=0.5;
+    myNode->getParam("pose_history_size",poseHistorySize);
+    myNode->getParam("pose_history_max_gap",poseHistoryMaxGap);
+    poseHistory=new PoseHistory((poseHistorySize>0)?(size_t)poseHistorySize:1,
+                                (poseHistoryMaxGap>0)?(uint64_t)(poseHistoryMaxGap*1e9):0);
+    //--------------------------------------------------
 
     // Publishers
     my_markers_pub=myNode->advertise<aruco_positioning_system::ArUcoMarkers>("ArUcoMarkersPose",1);
     marker_pub=myNode->advertise<visualization_msgs::Marker>("aruco_marker",1);
+    tf_pub=myNode->advertise<tf2_msgs::TFMessage>("/tf",100);
+    // Services
+    pose_at_time_srv=myNode->advertiseService("ArUcoPoseAtTime",&ViewPoint_Estimator::pose_at_time,this);
+
+    // Localisation reads published versions of map
+    mapReader=mapSnapshots.register_reader();
     //--------------------------------------------------
 
     // Loading calibration parameters
@@ -96,7 +231,13 @@ ViewPoint_Estimator::ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMak
 
     // Inicialization of marker
     //--------------------------------------------------
-    cv::namedWindow("Mono8", CV_WINDOW_AUTOSIZE);
+    if(showImage==true)
+        cv::namedWindow("Mono8", CV_WINDOW_AUTOSIZE);
+    //--------------------------------------------------
+
+    // Detector only decodes IDs, corners are refined after filtering of IDs
+    //--------------------------------------------------
+    setup_detector(MDetector);
     //--------------------------------------------------
 
 
@@ -113,9 +254,63 @@ ViewPoint_Estimator::ViewPoint_Estimator(ros::NodeHandle *myNode, float paramMak
     for(int j=0;j<numberOfAllMarkers;j++)
     {
         AllMarkers[j].relatedMarkerID=-1;
-        AllMarkers[j].active=false;
         AllMarkers[j].markerID=-1;
     }
+
+    // Preallocation of per-frame storage, image processing does not allocate after first frames
+    //--------------------------------------------------
+    // Names of TFs
+    for(int j=0;j<numberOfAllMarkers;j++)
+    {
+        std::stringstream markerTFID;
+        markerTFID << "marker_" << j;
+        markerFrameNames.push_back(markerTFID.str());
+        std::stringstream cameraTFID;
+        cameraTFID << "camera_" << j;
+        cameraFrameNames.push_back(cameraTFID.str());
+        std::stringstream markerGlobe;
+        markerGlobe << "marker_globe_" << j;
+        markerGlobeFrameNames.push_back(markerGlobe.str());
+    }
+    // Transforms of all markers and of visible markers
+    markerTransforms.resize(numberOfAllMarkers);
+    markerGlobeTransforms.resize(numberOfAllMarkers);
+    cameraTransforms.resize(numberOfAllMarkers);
+    visibleTransforms.reserve(numberOfAllMarkers);
+    visibleGlobeTransforms.reserve(numberOfAllMarkers);
+    visibleWorldTransforms.reserve(numberOfAllMarkers);
+    rigid_identity(worldPosition);
+    // All TFs of one publishing are sent at once, visible and neighbour markers and part of map
+    // Strings of TFs keep their capacity, so frame names are copied without allocation
+    tfPool.resize(6*numberOfAllMarkers+1);
+    tfCount=0;
+    tfMessage.transforms.reserve(tfPool.size());
+    tfPublishedRound.resize(numberOfAllMarkers,0);
+    tfRound=0;
+    // Detected, visible, new and neighbour markers
+    markers.reserve(numberOfAllMarkers);
+    markerPoses.reserve(numberOfAllMarkers);
+    visibleMarkers.reserve(numberOfAllMarkers);
+    newMarkers.reserve(numberOfAllMarkers);
+    neighbourMarkers.reserve(numberOfAllMarkers);
+    // Message
+    ArUcoMarkersMsgs.header.frame_id=worldFrameName;
+    ArUcoMarkersMsgs.markersID.reserve(numberOfAllMarkers);
+    ArUcoMarkersMsgs.markersPose.reserve(numberOfAllMarkers);
+    ArUcoMarkersMsgs.cameraPose.reserve(numberOfAllMarkers);
+    // Visualization marker for RVIZ, only frame, ID, pose and stamp are changed
+    rvizMarker.ns="basic_shapes";
+    rvizMarker.type=visualization_msgs::Marker::CUBE;
+    rvizMarker.action=visualization_msgs::Marker::ADD;
+    rvizMarker.scale.x=markerSize;
+    rvizMarker.scale.y=markerSize;
+    rvizMarker.scale.z=0.01;
+    rvizMarker.color.r=1.0f;
+    rvizMarker.color.g=1.0f;
+    rvizMarker.color.b=1.0f;
+    rvizMarker.color.a=1.0f;
+    rvizMarker.lifetime=ros::Duration(0.2);
+    //--------------------------------------------------
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -125,7 +320,7 @@ ViewPoint_Estimator::~ViewPoint_Estimator()
     delete intrinsics;
     delete distortion_coeff;
     delete image_size;
-    delete myListener;
+    delete poseHistory;
     delete [] AllMarkers;
 }
 
@@ -136,55 +331,318 @@ ViewPoint_Estimator::image_callback(const sensor_msgs::ImageConstPtr &original_i
 {
     // ROS Image to Mat structure
     //--------------------------------------------------
-    cv_bridge::CvImagePtr cv_ptr;
-    try
-    {
-        cv_ptr=cv_bridge::toCvCopy(original_image, sensor_msgs::image_encodings::MONO8);
-    }
-    catch (cv_bridge::Exception& e)
-    {
-        ROS_ERROR("Error open image %s", e.what());
+    cv::Mat image;
+    if(image_from_message(original_image,image)==false)
         return;
-    }
-    I=cv_ptr->image;
     //--------------------------------------------------
 
-    // Region Of Interest
-    if(regionOfInterest==true)
-        I=cv_ptr->image(cv::Rect(ROIx,ROIy,ROIw,ROIh));
+    cv::Point2d scale;
+    cv::Rect crop;
+    if(prepare_image(image,scale,crop)==false)
+        return;
+    select_camera_model(scale,crop);
+
+    // Image for drawing, message data is not changed
+    cv::Mat output_image;
+    if(showImage==true)
+    {
+        image.copyTo(I);
+        output_image=I;
+    }
 
     // Marker detection
     //--------------------------------------------------
     if(StartNow==true)
-        bool found=markers_find_pattern(I,I);
+        bool found=markers_find_pattern(image,output_image);
     //--------------------------------------------------
 
     // Show image
-    cv::imshow("Mono8", I);
-    cv::waitKey(10);
+    if(showImage==true)
+    {
+        cv::imshow("Mono8", I);
+        cv::waitKey(10);
+    }
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void
+transform2pose(const RigidTransform &transform, geometry_msgs::Pose &pose)
+{
+    double quaternion[4];
+    rigid_to_quaternion(transform,quaternion);
+    pose.position.x=transform.t[0];
+    pose.position.y=transform.t[1];
+    pose.position.z=transform.t[2];
+    pose.orientation.x=quaternion[0];
+    pose.orientation.y=quaternion[1];
+    pose.orientation.z=quaternion[2];
+    pose.orientation.w=quaternion[3];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool
 ViewPoint_Estimator::markers_find_pattern(cv::Mat input_image,cv::Mat output_image)
 {
-    aruco::MarkerDetector MDetector;
-    std::vector<aruco::Marker> markers;
+    // Stationary scene - previous detections and position are valid, only stamp is new
+    // Every Nth image is processed, any motion starts processing of every image immediately
+    if((stationaryDetector.update(input_image)==true)&&((stationaryDetector.stationary_frames()%stationaryDuty)!=0))
+    {
+        stationarySkipped=true;
+        republish_last_position(ros::Time::now());
+        return ArUcoMarkersMsgs.visibility;
+    }
+    if(stationarySkipped==true)
+    {
+        // Tracked corners are from image before skipped images
+        markerTracker.request_detection();
+        stationarySkipped=false;
+    }
 
-    // Initialization, all markers sign of visibility is set to false
-    for(int j=0;j<numberOfAllMarkers;j++)
-        AllMarkers[j].active=false;
+    // Quality of actual image, bad image is not detected or it does not add new markers
+    FrameQuality quality;
+    measure_frame(input_image,quality);
+    const bool goodFrame=check_frame_quality(quality);
+    if((goodFrame==false)&&(frameQualityMode==QUALITY_SKIP))
+    {
+        // Motion over skipped image can be too large for tracking
+        markerTracker.request_detection();
+        return false;
+    }
 
-    // Actual count of found markers before new image processing
-    markerCounter_before=markersCounter;
+    // Markers are tracked between full detections, full detection is done if tracking fails
+    if(markerTracker.track(input_image,markers)==false)
+    {
+        detect_markers(MDetector,input_image,markers);
+        if(markerTracker.enabled()==true)
+            markerTracker.reset(input_image,markers);
+    }
+
+    // Pose and mapping
+    return process_markers(ros::Time::now(),output_image,goodFrame);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // Actual ID of marker, which is processed
-    int MarrkerArrayID;
+bool
+ViewPoint_Estimator::image_from_message(const sensor_msgs::ImageConstPtr &message, cv::Mat &image)
+{
+    // Mono8, YUV and Bayer images are used without colour conversion
+    if(lumaIngest.ingest(*message,image)==true)
+        return true;
 
+    cv_bridge::CvImageConstPtr cv_ptr;
+    try
+    {
+        cv_ptr=cv_bridge::toCvShare(message, sensor_msgs::image_encodings::MONO8);
+    }
+    catch (cv_bridge::Exception& e)
+    {
+        ROS_ERROR("Error open image %s", e.what());
+        return false;
+    }
+    image=cv_ptr->image;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ViewPoint_Estimator::prepare_image(cv::Mat &image, cv::Point2d &scale, cv::Rect &crop) const
+{
+    // Resolution relative to calibration - half resolution from Bayer, binning or decimation of camera
+    // Size of calibration image is used, if it is in calibration file
+    scale=cameraModels.scale_of_size(image.size(),lumaIngest.scale());
+    // Region Of Interest, it is given in pixels of full resolution
+    crop=cv::Rect(0,0,image.cols,image.rows);
+    if(regionOfInterest==true)
+        crop&=cv::Rect((int)(ROIx*scale.x),(int)(ROIy*scale.y),(int)(ROIw*scale.x),(int)(ROIh*scale.y));
+    if(crop.area()==0)
+    {
+        ROS_ERROR("Region of interest is out of image");
+        return false;
+    }
+    if(regionOfInterest==true)
+        image=image(crop);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::select_camera_model(const cv::Point2d &scale, const cv::Rect &crop)
+{
+    if((scale!=cameraScale)||(crop!=cameraCrop))
+        update_camera_model(scale,crop);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+aruco::CameraParameters
+ViewPoint_Estimator::camera_parameters_of_size(const cv::Size &size)
+{
+    // Copy, models of cache are deleted when it is full
+    const cv::Point2d scale=cameraModels.scale_of_size(size,1.0);
+    return cameraModels.model(scale,cv::Rect(0,0,size.width,size.height)).parameters;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::measure_frame(const cv::Mat &input_image, FrameQuality &quality) const
+{
+    if(frameQualityMode!=QUALITY_OFF)
+        frameQualityGate.measure(input_image,quality);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ViewPoint_Estimator::check_frame_quality(const FrameQuality &quality)
+{
+    if(frameQualityMode==QUALITY_OFF)
+        return true;
+
+    const bool goodFrame=frameQualityGate.accept(quality);
+    if(goodFrame==false)
+    {
+        badFrames++;
+        ROS_DEBUG("Bad image - sharpness %.1f (reference %.1f), saturated %.2f, dark %.2f",
+                  quality.sharpness,frameQualityGate.reference_sharpness(),quality.saturated,quality.dark);
+    }
+    return goodFrame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ViewPoint_Estimator::process_detected_markers(std::vector<aruco::Marker> &detected, const ros::Time &stamp, const FrameQuality &quality)
+{
+    const bool goodFrame=check_frame_quality(quality);
+    if((goodFrame==false)&&(frameQualityMode==QUALITY_SKIP))
+        return false;
+
+    // Markers detected outside of estimator, arrays are swapped without copy
+    markers.swap(detected);
+    return process_markers(stamp,cv::Mat(),goodFrame);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::setup_detector(aruco::MarkerDetector &detector) const
+{
+    // Detector only decodes IDs, corners are refined after filtering of IDs
+    detector.setCornerRefinementMethod(aruco::MarkerDetector::NONE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::detect_markers(aruco::MarkerDetector &detector, const cv::Mat &input_image, std::vector<aruco::Marker> &detected) const
+{
     // Markers Detector, if return marker.size() 0, it dint finf any marker in image
-    MDetector.detect(input_image,markers,arucoCalibParams,markerSize);
+    // Without camera parameters only IDs are decoded, pose is not calculated
+    detector.detect(input_image,detected);
+
+    // Markers with not accepted ID are removed before any pose calculation
+    markerIdFilter.filter(detected);
+
+    // Corner refinement of accepted markers
+    for(size_t i=0;i<detected.size();i++)
+    {
+        cv::cornerSubPix(input_image,static_cast<std::vector<cv::Point2f>&>(detected[i]),cv::Size(5,5),cv::Size(-1,-1),
+                         cv::TermCriteria(cv::TermCriteria::MAX_ITER|cv::TermCriteria::EPS,12,0.005));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class Space>
+void
+ViewPoint_Estimator::map_new_markers()
+{
+    // Pose of detected marker in camera frame
+    RigidTransform markerTransform;
+
+    for(size_t n=0;n<newMarkers.size();n++)
+    {
+        const aruco::Marker &newMarker=markers[newMarkers[n]];
+
+        // Array of markers is full
+        if(markersCounter>=numberOfAllMarkers)
+        {
+            ROS_WARN("Marker %d can not be added, increase markers_number", newMarker.id);
+            break;
+        }
+
+        // Visible marker, which position of new marker is calculated
+        const int lastVisible=closest_visible_marker();
+        // Any known marker is not visible
+        if(lastVisible<0)
+            break;
+        const int lastMarlerID=visibleMarkers[lastVisible];
+
+        arucoMarker2Transform(markerPoses[newMarkers[n]],markerTransform);
+
+        // Relative position of new marker - camera over old marker and new marker in camera frame
+        // In the plane only x, y and yaw are calculated, roll, pitch and Z are zero
+        RigidTransform oldCamera,camera,transform;
+        typename Space::Pose relative,oldGlobe,globe;
+        visibleTransforms.get(lastVisible,oldCamera);
+        if(Space::relative(oldCamera,markerTransform,relative)==false)
+        {
+            ROS_WARN("Marker %d is not in plane of marker %d, it is not added", newMarker.id, AllMarkers[lastMarlerID].markerID);
+            continue;
+        }
+
+        int MarrkerArrayID=markersCounter;
+        std::cout << "New marker " << MarrkerArrayID << " and its ID " << newMarker.id << std::endl;
+        AllMarkers[MarrkerArrayID].markerID=newMarker.id;
+        AllMarkers[MarrkerArrayID].relatedMarkerID=lastMarlerID;
+        Space::lift(relative,transform);
+        markerTransforms.set(MarrkerArrayID,transform);
+
+        // Position of camera over new marker
+        rigid_invert(markerTransform,camera);
+
+        // Global position of new marker - global position of old marker and relative position
+        markerGlobeTransforms.get(lastMarlerID,transform);
+        Space::load(transform,oldGlobe);
+        Space::compose(oldGlobe,relative,globe);
+        Space::lift(globe,transform);
+        markerGlobeTransforms.set(MarrkerArrayID,transform);
+
+        // increasing count of markers
+        markersCounter++;
+
+        // New marker is known and visible from now
+        markerMapIndex.insert_id(newMarker.id,MarrkerArrayID);
+        markerMapIndex.insert_position(MarrkerArrayID,transform.t[0],transform.t[1],transform.t[2]);
+        visibleMarkers.push_back(MarrkerArrayID);
+        visibleTransforms.resize(visibleMarkers.size());
+        visibleTransforms.set(visibleMarkers.size()-1,camera);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+ViewPoint_Estimator::process_markers(const ros::Time &stamp, cv::Mat output_image, bool add_new_markers)
+{
+    // Initialization, markers visible in actual image are found again
+    visibleMarkers.resize(0);
+    newMarkers.resize(0);
+    // Pose of detected marker in camera frame
+    RigidTransform markerTransform;
+
+    // Actual count of found markers before new image processing
+    markerCounter_before=markersCounter;
+
+    // Pose of all accepted markers at once
+    poseSolver.solve(markers,markerPoses);
 
     // Any marker wasnt find
     if(markers.size()==0)
@@ -213,41 +671,11 @@ ViewPoint_Estimator::markers_find_pattern(cv::Mat input_image,cv::Mat output_ima
 
         // Position of my beginning - origin [0,0,0]
         AllMarkers[0].markerID=lowestIDMarker;
-        AllMarkers[0].AllMarkersPose.position.x=0;
-        AllMarkers[0].AllMarkersPose.position.y=0;
-        AllMarkers[0].AllMarkersPose.position.z=0;
-        // And orientation
-        AllMarkers[0].AllMarkersPose.orientation.x=0;
-        AllMarkers[0].AllMarkersPose.orientation.y=0;
-        AllMarkers[0].AllMarkersPose.orientation.z=0;
-        AllMarkers[0].AllMarkersPose.orientation.w=1;
-
-        // Relative position and Global position of Origin is same
-        AllMarkers[0].AllMarkersPoseGlobe.position.x=0;
-        AllMarkers[0].AllMarkersPoseGlobe.position.y=0;
-        AllMarkers[0].AllMarkersPoseGlobe.position.z=0;
-        AllMarkers[0].AllMarkersPoseGlobe.orientation.x=0;
-        AllMarkers[0].AllMarkersPoseGlobe.orientation.y=0;
-        AllMarkers[0].AllMarkersPoseGlobe.orientation.z=0;
-        AllMarkers[0].AllMarkersPoseGlobe.orientation.w=1;
-
-        // Transformation Pose to TF
-
-        tf::Vector3 origin;
-        origin.setX(0);
-        origin.setY(0);
-        origin.setZ(0);
-
-        tf::Quaternion quat;
-        quat.setX(0);
-        quat.setY(0);
-        quat.setZ(0);
-        quat.setW(1);
-
-        AllMarkers[0].AllMarkersTransform.setOrigin(origin);
-        AllMarkers[0].AllMarkersTransform.setRotation(quat);
         // Relative position and Global position of first marker - Origin is same
-        AllMarkers[0].AllMarkersTransformGlobe=AllMarkers[0].AllMarkersTransform;
+        RigidTransform origin;
+        rigid_identity(origin);
+        markerTransforms.set(0,origin);
+        markerGlobeTransforms.set(0,origin);
 
         // Increasing count of actual markers
         markersCounter++;
@@ -258,253 +686,90 @@ ViewPoint_Estimator::markers_find_pattern(cv::Mat input_image,cv::Mat output_ima
 
         // Position of origin is relative to global position, no relative position to any marker
         AllMarkers[0].relatedMarkerID=-2;
-        // Sign of visibilitys
-        AllMarkers[0].active=true;
+
+        // Origin is the first marker of map index
+        markerMapIndex.insert_id(lowestIDMarker,0);
+        markerMapIndex.insert_position(0,0,0,0);
     }
     //------------------------------------------------------
 
     //------------------------------------------------------
-    // Addings new markers and mapping
+    // Known markers - sign of visibility and actual position of camera
     //------------------------------------------------------
     // Markers are always sorted in ascending
+    visibleTransforms.resize(markers.size());
     for(size_t i=0;i<markers.size();i++)
     {
-        int currentMarkerID=markers[i].id;
+        // Pose of marker was not solved
+        if(markerPoses[i].valid==false)
+            continue;
 
-        // Use only marker with modulo 10
-        if(currentMarkerID%10==0)
+        //------------------------------------------------------
+        //Draw marker convex, ID, cube and axis
+        //------------------------------------------------------
+        if(output_image.empty()==false)
         {
-            //------------------------------------------------------
-            //Draw marker convex, ID, cube and axis
-            //------------------------------------------------------
+            // Drawing utils of aruco use rotation and translation vector of marker
+            double rvec[3];
+            PlanarPoseSolver::rotation_to_rvec(markerPoses[i].R,rvec);
+            for(int k=0;k<3;k++)
+            {
+                markers[i].Rvec.at<float>(k,0)=(float)rvec[k];
+                markers[i].Tvec.at<float>(k,0)=(float)markerPoses[i].t[k];
+            }
             markers[i].draw(output_image, cv::Scalar(0,0,255),2);
             aruco::CvDrawingUtils::draw3dCube(output_image,markers[i],arucoCalibParams);
             aruco::CvDrawingUtils::draw3dAxis(output_image,markers[i],arucoCalibParams);
-
-            //------------------------------------------------------
-            // Check, if it see new marker or it has already known
-            //------------------------------------------------------
-            bool find=false;
-            int m_j=0;
-            while((find==false)&&(m_j<markersCounter))
-            {
-                if(AllMarkers[m_j].markerID==currentMarkerID)
-                {
-                    MarrkerArrayID=m_j;
-                    find=true;
-                    std::cout << "Existing ID was assigned" << std::endl;
-                }
-                m_j++;
-            }
-            if(find==false)
-            {
-                MarrkerArrayID=markersCounter;
-                AllMarkers[MarrkerArrayID].markerID=currentMarkerID;
-                find=true;
-                std::cout << "New marker" << std::endl;
-            }
-
-            //------------------------------------------------------
-            std::cout << "Actuak marker " << MarrkerArrayID << " and its ID " << AllMarkers[MarrkerArrayID].markerID << std::endl;
-            //------------------------------------------------------
-
-            //------------------------------------------------------
-            // Sign of visivility of marker
-            // If new marker is found, sign of visibility must be changed
-            //------------------------------------------------------
-            for(int j=0;j<markersCounter;j++)
-            {
-                for(size_t im=0;im<markers.size();im++)
-                {
-                    if(AllMarkers[j].markerID==markers[im].id)
-                        AllMarkers[j].active=true;
-                }
-            }
-            //------------------------------------------------------
-
-            //------------------------------------------------------
-            // Old marker was found in the image
-            //------------------------------------------------------
-            if((MarrkerArrayID<markersCounter)&&(lookingForFirst==true))
-            {
-                AllMarkers[MarrkerArrayID].CurrentCameraTf=arucoMarker2Tf(markers[i]);
-                AllMarkers[MarrkerArrayID].CurrentCameraTf=AllMarkers[MarrkerArrayID].CurrentCameraTf.inverse();
-
-                const tf::Vector3 marker_origin=AllMarkers[MarrkerArrayID].CurrentCameraTf.getOrigin();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.x=marker_origin.getX();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.y=marker_origin.getY();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.z=marker_origin.getZ();
-
-                const tf::Quaternion marker_quaternion=AllMarkers[MarrkerArrayID].CurrentCameraTf.getRotation();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.x=marker_quaternion.getX();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.y=marker_quaternion.getY();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.z=marker_quaternion.getZ();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.w=marker_quaternion.getW();
-            }
-
-            //------------------------------------------------------
-            // New marker was found
-            // Global and relative position must be calculated
-            //------------------------------------------------------
-            if((MarrkerArrayID==markersCounter)&&(lookingForFirst==true))
-            {
-                AllMarkers[MarrkerArrayID].CurrentCameraTf=arucoMarker2Tf(markers[i]);
-
-                tf::Vector3 marker_origin=AllMarkers[MarrkerArrayID].CurrentCameraTf.getOrigin();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.x=marker_origin.getX();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.y=marker_origin.getY();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.position.z=marker_origin.getZ();
-
-                tf::Quaternion marker_quaternion=AllMarkers[MarrkerArrayID].CurrentCameraTf.getRotation();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.x=marker_quaternion.getX();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.y=marker_quaternion.getY();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.z=marker_quaternion.getZ();
-                AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.w=marker_quaternion.getW();
-
-                // Naming - TFs
-                std::stringstream cameraTFID;
-                cameraTFID << "camera_" << MarrkerArrayID;
-                std::stringstream cameraTFID_old;
-                std::stringstream markerTFID_old;
-
-                // Sing if any known marker is visible
-                bool anyMarker=false;
-                // Array ID of markers, which position of new marker is calculated
-                int lastMarlerID;
-
-                // Testing, if is possible calculate position of a new marker to old known marker
-                for(int k=0;k<MarrkerArrayID;k++)
-                {
-                    if((AllMarkers[k].active==true)&&(anyMarker==false))
-                    {
-                        if(AllMarkers[k].relatedMarkerID!=-1)
-                        {
-                            anyMarker=true;
-                            cameraTFID_old << "camera_" << k;
-                            markerTFID_old << "marker_" << k;
-                            AllMarkers[MarrkerArrayID].relatedMarkerID=k;
-                            lastMarlerID=k;
-                        }
-                    }
-                }
-
-                // New position can be calculated
-                if(anyMarker==true)
-                {
-                    // Generating TFs for listener
-                    for(char k=0;k<10;k++)
-                    {
-                        // TF from old marker and its camera
-                        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[lastMarlerID].CurrentCameraTf,ros::Time::now(),markerTFID_old.str(),cameraTFID_old.str()));
-                          // TF from old camera to new camera
-                        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[MarrkerArrayID].CurrentCameraTf,ros::Time::now(),cameraTFID_old.str(),cameraTFID.str()));
-                        usleep(100);
-                    }
-
-                    // Calculate TF between two markers
-                    myListener->waitForTransform(markerTFID_old.str(),cameraTFID.str(),ros::Time(0),ros::Duration(2.0));
-                    try
-                    {
-                        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[lastMarlerID].CurrentCameraTf,ros::Time::now(),markerTFID_old.str(),cameraTFID_old.str()));
-                        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[MarrkerArrayID].CurrentCameraTf,ros::Time::now(),cameraTFID_old.str(),cameraTFID.str()));
-
-                        myListener->lookupTransform(markerTFID_old.str(),cameraTFID.str(),ros::Time(0),AllMarkers[MarrkerArrayID].AllMarkersTransform);
-                    }
-                    catch(tf::TransformException &ex)
-                    {
-                        ROS_ERROR("Error - 1\n");
-                        ros::Duration(2.0).sleep();
-                    }
-
-                    // Saving quaternion and origin of calculated TF to pose
-                    marker_quaternion=AllMarkers[MarrkerArrayID].AllMarkersTransform.getRotation();
-                    // If all markers are in the plane, for better accuracy, we known that roll and pitch are zero
-                    if(type_of_space=="plane")
-                    {
-                        double roll,pitch,yaw;
-                        tf::Matrix3x3(marker_quaternion).getRPY(roll,pitch,yaw);
-                        roll=0;
-                        pitch=0;
-                        marker_quaternion.setRPY(pitch,roll,yaw);
-                    }
-                    AllMarkers[MarrkerArrayID].AllMarkersTransform.setRotation(marker_quaternion);
-
-                    marker_origin=AllMarkers[MarrkerArrayID].AllMarkersTransform.getOrigin();
-                    // If all markers are in the plane, for better accuracy, we known that Z is zero
-                    if(type_of_space=="plane")
-                        marker_origin.setZ(0);
-                    AllMarkers[MarrkerArrayID].AllMarkersTransform.setOrigin(marker_origin);
-
-                    marker_origin=AllMarkers[MarrkerArrayID].AllMarkersTransform.getOrigin();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.position.x=marker_origin.getX();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.position.y=marker_origin.getY();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.position.z=marker_origin.getZ();
-
-                    marker_quaternion=AllMarkers[MarrkerArrayID].AllMarkersTransform.getRotation();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.orientation.x=marker_quaternion.getX();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.orientation.y=marker_quaternion.getY();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.orientation.z=marker_quaternion.getZ();
-                    AllMarkers[MarrkerArrayID].AllMarkersPose.orientation.w=marker_quaternion.getW();
-
-                    // increasing count of markers
-                    markersCounter++;
-
-                    //--------------------------------------
-                    // Position of new marker have to be inversed, because i need for calculating of a next new marker position inverse TF of old markers
-                    //--------------------------------------
-                    AllMarkers[MarrkerArrayID].CurrentCameraTf=AllMarkers[MarrkerArrayID].CurrentCameraTf.inverse();
-                    marker_origin=AllMarkers[MarrkerArrayID].CurrentCameraTf.getOrigin();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.position.x=marker_origin.getX();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.position.y=marker_origin.getY();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.position.z=marker_origin.getZ();
-                    marker_quaternion=AllMarkers[MarrkerArrayID].CurrentCameraTf.getRotation();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.x=marker_quaternion.getX();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.y=marker_quaternion.getY();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.z=marker_quaternion.getZ();
-                    AllMarkers[MarrkerArrayID].CurrentCameraPose.orientation.w=marker_quaternion.getW();
-
-                    // Publishing of all TFs and markers
-                    publish_tfs(false);
-                }
-            }
         }
 
-
         //------------------------------------------------------
-        // New Marker was found, its global position is calculated
+        // Check, if it see new marker or it has already known
         //------------------------------------------------------
-        if((markerCounter_before<markersCounter)&&(lookingForFirst==true))
+        int MarrkerArrayID=markerMapIndex.find_id(markers[i].id);
+        if(MarrkerArrayID<0)
         {
-            // Publishing all TF for five times for listener
-            for(char k=0;k<5;k++)
-                publish_tfs(false);
-
-            std::stringstream markerGlobe;
-            markerGlobe << "marker_" << MarrkerArrayID;
+            // New marker is added after all known markers are processed
+            newMarkers.push_back(i);
+            continue;
+        }
 
-            myListener->waitForTransform("world",markerGlobe.str(),ros::Time(0),ros::Duration(2.0));
-            try
-            {
-                myListener->lookupTransform("world",markerGlobe.str(),ros::Time(0),AllMarkers[MarrkerArrayID].AllMarkersTransformGlobe);
-            }
-            catch(tf::TransformException &ex)
-            {
-                ROS_ERROR("Error - 2 Global position of marker\n");
-                ros::Duration(2.0).sleep();
-            }
+        //------------------------------------------------------
+        // Marker is visible in actual image
+        //------------------------------------------------------
+        visibleMarkers.push_back(MarrkerArrayID);
 
-            // Saving TF to Pose
-            const tf::Vector3 marker_origin=AllMarkers[MarrkerArrayID].AllMarkersTransformGlobe.getOrigin();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.position.x=marker_origin.getX();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.position.y=marker_origin.getY();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.position.z=marker_origin.getZ();
-            tf::Quaternion marker_quaternion=AllMarkers[MarrkerArrayID].AllMarkersTransformGlobe.getRotation();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.orientation.x=marker_quaternion.getX();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.orientation.y=marker_quaternion.getY();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.orientation.z=marker_quaternion.getZ();
-            AllMarkers[MarrkerArrayID].AllMarkersPoseGlobe.orientation.w=marker_quaternion.getW();
-        }
+        //------------------------------------------------------
+        // Old marker was found in the image, it is inverted with other visible markers
+        //------------------------------------------------------
+        arucoMarker2Transform(markerPoses[i],markerTransform);
+        visibleTransforms.set(visibleMarkers.size()-1,markerTransform);
     }
+
+    // Position of camera over each visible marker
+    visibleTransforms.resize(visibleMarkers.size());
+    visibleTransforms.invert();
+    //------------------------------------------------------
+
+    //------------------------------------------------------
+    // New markers were found
+    // Global and relative position is calculated to the closest visible known marker
+    // Bad image does not add new markers, its poses would be saved to map
+    //------------------------------------------------------
+    if(add_new_markers==false)
+        newMarkers.resize(0);
+    // Space model is resolved once per image, not for each marker
+    if(spaceModel==SPACE_PLANE)
+        map_new_markers<SpacePlane>();
+    else
+        map_new_markers<Space3D>();
+
+    // Changed map is published as new version
+    // Localisation uses only published version and markers visible in actual image, not working state of mapping
+    if(markersCounter!=markerCounter_before)
+        publish_map_snapshot();
+    MarkerMapReadGuard map(mapSnapshots,mapReader);
+    // Last position of camera over each visible marker for TFs of camera frames
+    visibleTransforms.scatter(visibleMarkers,cameraTransforms);
     //------------------------------------------------------
 
 
@@ -512,235 +777,396 @@ ViewPoint_Estimator::markers_find_pattern(cv::Mat input_image,cv::Mat output_ima
     // Calculating ot the shortest camera distance to some marker
     // Camera with the shortest distance is used as reference of global position of object (camera)
     //------------------------------------------------------
-
-    bool someMarkersAreVisible=false;
-    int numberOfVisibleMarkers=0;
-
-    if(lookingForFirst==true)
+    const int numberOfVisibleMarkers=(int)visibleMarkers.size();
+    const bool someMarkersAreVisible=(lookingForFirst==true)&&(numberOfVisibleMarkers>0)&&(map.get()!=NULL);
+    int closestVisible=-1;
+    if(someMarkersAreVisible==true)
     {
-        double minSize=999999;
-        for(int k=0;k<numberOfAllMarkers;k++)
-        {
-            double a;
-            double b;
-            double c;
-            double size;
-            // If marker is active, distance is calculated
-            if(AllMarkers[k].active==true)
-            {
-                a=AllMarkers[k].CurrentCameraPose.position.x;
-                b=AllMarkers[k].CurrentCameraPose.position.y;
-                c=AllMarkers[k].CurrentCameraPose.position.z;
-                size=std::sqrt((a*a)+(b*b)+(c*c));
-                if(size<minSize)
-                {
-                    minSize=size;
-                    indexActualCamera=k;
-                }
-
-                someMarkersAreVisible=true;
-                numberOfVisibleMarkers++;
-            }
-        }
+        closestVisible=closest_visible_marker();
+        indexActualCamera=visibleMarkers[closestVisible];
     }
     //------------------------------------------------------
 
-    //------------------------------------------------------
-    // Publish all known markers
-    //------------------------------------------------------
-    if(lookingForFirst==true)
-        publish_tfs(true);
-    //------------------------------------------------------
-
     //------------------------------------------------------
     // Calculating TF od closer camera
     // Camera with the shortest distance is used as reference of global position of object (camera)
     //------------------------------------------------------
     //---
-    if((lookingForFirst==true)&&(someMarkersAreVisible==true))
+    if(someMarkersAreVisible==true)
     {
-        std::stringstream closestCamera;
-        closestCamera << "camera_" << indexActualCamera;
-
-        myListener->waitForTransform("world",closestCamera.str(),ros::Time(0),ros::Duration(2.0));
-        try
-        {
-            myListener->lookupTransform("world",closestCamera.str(),ros::Time(0),myWorldPosition);
-        }
-        catch(tf::TransformException &ex)
-        {
-            ROS_ERROR("Error - 3\n");
-        }
-
-        // Saving TF to Pose
-        const tf::Vector3 marker_origin=myWorldPosition.getOrigin();
-        myWorldPositionPose.position.x=marker_origin.getX();
-        myWorldPositionPose.position.y=marker_origin.getY();
-        myWorldPositionPose.position.z=marker_origin.getZ();
-        tf::Quaternion marker_quaternion=myWorldPosition.getRotation();
-        myWorldPositionPose.orientation.x=marker_quaternion.getX();
-        myWorldPositionPose.orientation.y=marker_quaternion.getY();
-        myWorldPositionPose.orientation.z=marker_quaternion.getZ();
-        myWorldPositionPose.orientation.w=marker_quaternion.getW();
+        // Global position of camera over each visible marker at once, closest marker is used
+        visibleGlobeTransforms.gather(map->markerGlobeTransforms,visibleMarkers);
+        visibleWorldTransforms=visibleTransforms;
+        visibleWorldTransforms.compose_left(visibleGlobeTransforms);
+        visibleWorldTransforms.get(closestVisible,worldPosition);
+
+        // History of global positions for queries in past
+        poseHistory->push(stamp.toNSec(),worldPosition);
     }
     //------------------------------------------------------
 
     //------------------------------------------------------
-    // Publish all known markers
+    // Publish whole map, or visible markers, neighbourhood and part of the map
     //------------------------------------------------------
-    if(lookingForFirst==true)
-        publish_tfs(true);
+    if(map.get()!=NULL)
+        publish_map_tfs(*map.get(),stamp,true,tfWholeMap);
     //------------------------------------------------------
 
     //------------------------------------------------------
     // Publisging ArUcoMarkersPose message
     //------------------------------------------------------
+    // Arrays of message are preallocated, resize does not allocate memory
+    // Transforms are converted to poses only here
     if((someMarkersAreVisible==true))
     {
-        ArUcoMarkersMsgs.header.stamp=ros::Time::now();
-        ArUcoMarkersMsgs.header.frame_id="world";
+        ArUcoMarkersMsgs.header.stamp=stamp;
         ArUcoMarkersMsgs.numberOfMarkers=numberOfVisibleMarkers;
         ArUcoMarkersMsgs.visibility=true;
-        ArUcoMarkersMsgs.globalPose=myWorldPositionPose;
-        ArUcoMarkersMsgs.markersID.clear();
-        ArUcoMarkersMsgs.markersPose.clear();
-        ArUcoMarkersMsgs.cameraPose.clear();
-        for(int j=0;j<markersCounter;j++)
+        transform2pose(worldPosition,ArUcoMarkersMsgs.globalPose);
+        ArUcoMarkersMsgs.markersID.resize(numberOfVisibleMarkers);
+        ArUcoMarkersMsgs.markersPose.resize(numberOfVisibleMarkers);
+        ArUcoMarkersMsgs.cameraPose.resize(numberOfVisibleMarkers);
+        RigidTransform transform;
+        for(int v=0;v<numberOfVisibleMarkers;v++)
         {
-            if(AllMarkers[j].active==true)
-            {
-                ArUcoMarkersMsgs.markersID.push_back(AllMarkers[j].markerID);
-                ArUcoMarkersMsgs.markersPose.push_back(AllMarkers[j].AllMarkersPoseGlobe);
-                ArUcoMarkersMsgs.cameraPose.push_back(AllMarkers[j].CurrentCameraPose);
-            }
+            const int j=visibleMarkers[v];
+            ArUcoMarkersMsgs.markersID[v]=map->markerIDs[j];
+            visibleGlobeTransforms.get(v,transform);
+            transform2pose(transform,ArUcoMarkersMsgs.markersPose[v]);
+            visibleTransforms.get(v,transform);
+            transform2pose(transform,ArUcoMarkersMsgs.cameraPose[v]);
         }
     }
     else
     {
-        ArUcoMarkersMsgs.header.stamp=ros::Time::now();
-        ArUcoMarkersMsgs.header.frame_id="world";
+        ArUcoMarkersMsgs.header.stamp=stamp;
         ArUcoMarkersMsgs.numberOfMarkers=numberOfVisibleMarkers;
         ArUcoMarkersMsgs.visibility=false;
-        ArUcoMarkersMsgs.markersID.clear();
-        ArUcoMarkersMsgs.markersPose.clear();
+        ArUcoMarkersMsgs.markersID.resize(0);
+        ArUcoMarkersMsgs.markersPose.resize(0);
+        ArUcoMarkersMsgs.cameraPose.resize(0);
     }
     //------------------------------------------------------
 
     // Publish
     my_markers_pub.publish(ArUcoMarkersMsgs);
 
+    // Same content for consumers on the same machine
+    if(poseShm.is_open()==true)
+        publish_shared_memory();
+
     return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
-void
-ViewPoint_Estimator::publish_tfs(bool world_option)
+bool
+ViewPoint_Estimator::pose_at_time(aruco_positioning_system::ArUcoPoseAtTime::Request &request,
+                                  aruco_positioning_system::ArUcoPoseAtTime::Response &response)
 {
-    for(int j=0;j<markersCounter;j++)
+    PoseHistoryEntry entry;
+    response.valid=poseHistory->query(request.stamp.toNSec(),entry);
+    if(response.valid==true)
     {
-        // Actual Marker
-        std::stringstream markerTFID;
-        markerTFID << "marker_" << j;
-        // Older marker - or World
-        std::stringstream markerTFID_old;
-        if(j==0)
-            markerTFID_old << "world";
-        else
-            markerTFID_old << "marker_" << AllMarkers[j].relatedMarkerID;
-        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[j].AllMarkersTransform,ros::Time::now(),markerTFID_old.str(),markerTFID.str()));
+        response.globalPose.position.x=entry.position[0];
+        response.globalPose.position.y=entry.position[1];
+        response.globalPose.position.z=entry.position[2];
+        response.globalPose.orientation.x=entry.orientation[0];
+        response.globalPose.orientation.y=entry.orientation[1];
+        response.globalPose.orientation.z=entry.orientation[2];
+        response.globalPose.orientation.w=entry.orientation[3];
+    }
+    return true;
+}
 
-        // Position of camera to its marker
-        std::stringstream cameraTFID;
-        cameraTFID << "camera_" << j;
-        myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[j].CurrentCameraTf,ros::Time::now(),markerTFID.str(),cameraTFID.str()));
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-        if(world_option==true)
+int
+ViewPoint_Estimator::closest_visible_marker()
+{
+    // Only visible markers are searched, cost does not depend on size of map
+    // Position in visible markers is returned, -1 if any marker is not visible
+    int closestMarker=-1;
+    if(visibleMarkers.empty()==true)
+        return closestMarker;
+    double minSize=999999;
+    for(size_t v=0;v<visibleMarkers.size();v++)
+    {
+        const double a=visibleTransforms.translation(0)[v];
+        const double b=visibleTransforms.translation(1)[v];
+        const double c=visibleTransforms.translation(2)[v];
+        const double size=std::sqrt((a*a)+(b*b)+(c*c));
+        if(size<minSize)
         {
-            // Global position of marker TF
-            std::stringstream markerGlobe;
-            markerGlobe << "marker_globe_" << j;
-            myBroadcaster.sendTransform(tf::StampedTransform(AllMarkers[j].AllMarkersTransformGlobe,ros::Time::now(),"world",markerGlobe.str()));
+            minSize=size;
+            closestMarker=(int)v;
         }
+    }
+    return closestMarker;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::publish_tfs(bool world_option, bool whole_map)
+{
+    MarkerMapReadGuard map(mapSnapshots,mapReader);
+    if(map.get()!=NULL)
+        publish_map_tfs(*map.get(),ros::Time::now(),world_option,whole_map);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-        // Cubes for RVIZ - markers
-        publish_marker(AllMarkers[j].AllMarkersPose,AllMarkers[j].markerID,j);
+void
+ViewPoint_Estimator::publish_map_tfs(const MarkerMapSnapshot &map, const ros::Time &stamp, bool world_option, bool whole_map)
+{
+    // All TFs are sent in one message, array of TFs is preallocated
+    tfCount=0;
+    tfRound++;
+
+    if(whole_map==true)
+    {
+        for(int j=0;j<map.numberOfMarkers;j++)
+            add_marker_tfs(map,j,stamp,world_option);
+    }
+    else
+    {
+        // Visible markers
+        for(size_t v=0;v<visibleMarkers.size();v++)
+            add_marker_tfs(map,visibleMarkers[v],stamp,world_option);
+
+        // Markers in neighbourhood of actual position
+        map.index.query_radius(worldPosition.t[0],worldPosition.t[1],worldPosition.t[2],tfNeighbourRadius,neighbourMarkers);
+        for(size_t n=0;n<neighbourMarkers.size();n++)
+            add_marker_tfs(map,neighbourMarkers[n],stamp,world_option);
+
+        // Part of remaining map, whole map is refreshed in several images
+        for(int k=0;(k<tfMapSlice)&&(k<map.numberOfMarkers);k++)
+        {
+            tfMapSliceStart=(tfMapSliceStart+1)%map.numberOfMarkers;
+            add_marker_tfs(map,tfMapSliceStart,stamp,world_option);
+        }
     }
 
     // Global Position of object
     if(world_option==true)
-        myBroadcaster.sendTransform(tf::StampedTransform(myWorldPosition,ros::Time::now(),"world","myGlobalPosition"));
+        add_tf(worldPosition,stamp,worldFrameName,globalPositionFrameName);
+
+    send_tfs();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
 void
-ViewPoint_Estimator::publish_marker(geometry_msgs::Pose markerPose, int MarkerID, int rank)
+ViewPoint_Estimator::add_marker_tfs(const MarkerMapSnapshot &map, int j, const ros::Time &stamp, bool world_option)
 {
-    visualization_msgs::Marker myMarker;
+    // Marker can be visible, in neighbourhood and in part of map at once, its TFs are sent only once
+    if(tfPublishedRound[j]==tfRound)
+        return;
+    tfPublishedRound[j]=tfRound;
 
-    if(rank==0)
-        myMarker.header.frame_id="world";
+    RigidTransform transform;
+
+    // Actual Marker to older marker - or World
+    map.markerTransforms.get(j,transform);
+    if(j==0)
+        add_tf(transform,stamp,worldFrameName,markerFrameNames[j]);
     else
+        add_tf(transform,stamp,markerFrameNames[map.relatedMarkers[j]],markerFrameNames[j]);
+
+    // Cubes for RVIZ - markers
+    publish_marker(transform,map.markerIDs[j],map.relatedMarkers[j]);
+
+    // Position of camera to its marker
+    cameraTransforms.get(j,transform);
+    add_tf(transform,stamp,markerFrameNames[j],cameraFrameNames[j]);
+
+    // Global position of marker TF
+    if(world_option==true)
     {
-        std::stringstream markerTFID_old;
-        markerTFID_old << "marker_" << AllMarkers[rank].relatedMarkerID;
-        myMarker.header.frame_id=markerTFID_old.str();
+        map.markerGlobeTransforms.get(j,transform);
+        add_tf(transform,stamp,worldFrameName,markerGlobeFrameNames[j]);
     }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-    myMarker.header.stamp=ros::Time::now();
-    myMarker.ns="basic_shapes";
-    myMarker.id=MarkerID;
-    myMarker.type=visualization_msgs::Marker::CUBE;
-    myMarker.action=visualization_msgs::Marker::ADD;
+void
+ViewPoint_Estimator::add_tf(const RigidTransform &transform, const ros::Time &stamp, const std::string &frame_id, const std::string &child_frame_id)
+{
+    // Pool grows only if more TFs than expected are sent
+    if(tfCount==tfPool.size())
+        tfPool.resize(tfCount+1);
+    geometry_msgs::TransformStamped &tf=tfPool[tfCount++];
+    double quaternion[4];
+    rigid_to_quaternion(transform,quaternion);
+    tf.transform.translation.x=transform.t[0];
+    tf.transform.translation.y=transform.t[1];
+    tf.transform.translation.z=transform.t[2];
+    tf.transform.rotation.x=quaternion[0];
+    tf.transform.rotation.y=quaternion[1];
+    tf.transform.rotation.z=quaternion[2];
+    tf.transform.rotation.w=quaternion[3];
+    tf.header.stamp=stamp;
+    tf.header.frame_id=frame_id;
+    tf.child_frame_id=child_frame_id;
+}
 
-    myMarker.pose=markerPose;
-    myMarker.scale.x=markerSize;
-    myMarker.scale.y=markerSize;
-    myMarker.scale.z=0.01;
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-    myMarker.color.r=1.0f;
-    myMarker.color.g=1.0f;
-    myMarker.color.b=1.0f;
-    myMarker.color.a=1.0f;
+void
+ViewPoint_Estimator::send_tfs()
+{
+    // Used TFs are swapped into message and back, strings are moved and pool keeps their memory
+    // Resizing of message only constructs and destroys empty TFs in reserved capacity
+    tfMessage.transforms.resize(tfCount);
+    for(size_t i=0;i<tfCount;i++)
+        std::swap(tfMessage.transforms[i],tfPool[i]);
+    tf_pub.publish(tfMessage);
+    for(size_t i=0;i<tfCount;i++)
+        std::swap(tfMessage.transforms[i],tfPool[i]);
+    tfMessage.transforms.resize(0);
+}
 
-    myMarker.lifetime=ros::Duration(0.2);
+////////////////////////////////////////////////////////////////////////////////////////////////
 
-    marker_pub.publish(myMarker);
+void
+ViewPoint_Estimator::publish_marker(const RigidTransform &markerTransform, int MarkerID, int relatedRank)
+{
+    // Other items of marker are set in constructor, origin is related to world
+    if(relatedRank<0)
+        rvizMarker.header.frame_id=worldFrameName;
+    else
+        rvizMarker.header.frame_id=markerFrameNames[relatedRank];
+
+    rvizMarker.header.stamp=ros::Time::now();
+    rvizMarker.id=MarkerID;
+    transform2pose(markerTransform,rvizMarker.pose);
+
+    marker_pub.publish(rvizMarker);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::publish_map_snapshot()
+{
+    // Copy of working map, it is done only when markers were added
+    MarkerMapSnapshot *snapshot=new MarkerMapSnapshot;
+    snapshot->numberOfMarkers=markersCounter;
+    snapshot->markerIDs.resize(markersCounter);
+    snapshot->relatedMarkers.resize(markersCounter);
+    for(int j=0;j<markersCounter;j++)
+    {
+        snapshot->markerIDs[j]=AllMarkers[j].markerID;
+        snapshot->relatedMarkers[j]=AllMarkers[j].relatedMarkerID;
+    }
+    snapshot->markerTransforms=markerTransforms;
+    snapshot->markerTransforms.resize(markersCounter);
+    snapshot->markerGlobeTransforms=markerGlobeTransforms;
+    snapshot->markerGlobeTransforms.resize(markersCounter);
+    snapshot->index=markerMapIndex;
+
+    mapSnapshots.publish(snapshot);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::republish_last_position(const ros::Time &stamp)
+{
+    // Message and TFs of last processed image with new stamp
+    ArUcoMarkersMsgs.header.stamp=stamp;
+    my_markers_pub.publish(ArUcoMarkersMsgs);
+    // Pool still contains last sent TFs, only their stamps are changed
+    for(size_t i=0;i<tfCount;i++)
+        tfPool[i].header.stamp=stamp;
+    if(tfCount>0)
+        send_tfs();
+    if(poseShm.is_open()==true)
+        publish_shared_memory();
+    if(ArUcoMarkersMsgs.visibility==true)
+        poseHistory->push(stamp.toNSec(),worldPosition);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline void
+pose2shm(const geometry_msgs::Pose &pose, PoseShmPose &shmPose)
+{
+    shmPose.position[0]=pose.position.x;
+    shmPose.position[1]=pose.position.y;
+    shmPose.position[2]=pose.position.z;
+    shmPose.orientation[0]=pose.orientation.x;
+    shmPose.orientation[1]=pose.orientation.y;
+    shmPose.orientation[2]=pose.orientation.z;
+    shmPose.orientation[3]=pose.orientation.w;
+}
+
+void
+ViewPoint_Estimator::publish_shared_memory()
+{
+    // Data are written directly to shared memory, readers repeat reading during writing
+    PoseShmData &data=poseShm.begin_write();
+
+    data.stamp=ArUcoMarkersMsgs.header.stamp.toNSec();
+    data.visibility=ArUcoMarkersMsgs.visibility;
+    pose2shm(ArUcoMarkersMsgs.globalPose,data.globalPose);
+
+    int numberOfMarkers=(int)ArUcoMarkersMsgs.markersID.size();
+    if(numberOfMarkers>POSE_SHM_MAX_MARKERS)
+        numberOfMarkers=POSE_SHM_MAX_MARKERS;
+    data.numberOfMarkers=numberOfMarkers;
+    for(int j=0;j<numberOfMarkers;j++)
+    {
+        data.markers[j].markerID=ArUcoMarkersMsgs.markersID[j];
+        pose2shm(ArUcoMarkersMsgs.markersPose[j],data.markers[j].markerPose);
+        pose2shm(ArUcoMarkersMsgs.cameraPose[j],data.markers[j].cameraPose);
+    }
+
+    poseShm.end_write();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
-tf::Transform
-ViewPoint_Estimator::arucoMarker2Tf(const aruco::Marker &marker)
+void
+ViewPoint_Estimator::arucoMarker2Transform(const MarkerPose &pose, RigidTransform &transform)
+{
+    // Rotation matrix of marker in camera frame
+    const double r00=pose.R[0],r01=pose.R[1],r02=pose.R[2];
+    const double r10=pose.R[3],r11=pose.R[4],r12=pose.R[5];
+    const double r20=pose.R[6],r21=pose.R[7],r22=pose.R[8];
+
+    // Rotation to ROS - multiplication by [-1 0 0; 0 0 1; 0 1 0], first column is negated, second and third are swapped
+    // Y of aruco is perpendicular to marker, so Z of marker frame is normal of marker plane
+    transform.R[0]=-r00; transform.R[1]=r02; transform.R[2]=r01;
+    transform.R[3]=-r10; transform.R[4]=r12; transform.R[5]=r11;
+    transform.R[6]=-r20; transform.R[7]=r22; transform.R[8]=r21;
+
+    transform.t[0]=pose.t[0];
+    transform.t[1]=pose.t[1];
+    transform.t[2]=pose.t[2];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void
+ViewPoint_Estimator::update_camera_model(const cv::Point2d &scale, const cv::Rect &crop)
 {
-    cv::Mat marker_rotation(3,3, CV_32FC1);
-    cv::Rodrigues(marker.Rvec, marker_rotation);
-    cv::Mat marker_translation = marker.Tvec;
-
-    cv::Mat rotate_to_ros(3,3,CV_32FC1);
-    rotate_to_ros.at<float>(0,0) = -1.0;
-    rotate_to_ros.at<float>(0,1) = 0;
-    rotate_to_ros.at<float>(0,2) = 0;
-    rotate_to_ros.at<float>(1,0) = 0;
-    rotate_to_ros.at<float>(1,1) = 0;
-    rotate_to_ros.at<float>(1,2) = 1.0;
-    rotate_to_ros.at<float>(2,0) = 0.0;
-    rotate_to_ros.at<float>(2,1) = 1.0;
-    rotate_to_ros.at<float>(2,2) = 0.0;
-
-    marker_rotation = marker_rotation * rotate_to_ros.t();
-
-    // Origin solution
-    tf::Matrix3x3 marker_tf_rot(marker_rotation.at<float>(0,0),marker_rotation.at<float>(0,1),marker_rotation.at<float>(0,2),
-                                marker_rotation.at<float>(1,0),marker_rotation.at<float>(1,1),marker_rotation.at<float>(1,2),
-                                marker_rotation.at<float>(2,0),marker_rotation.at<float>(2,1),marker_rotation.at<float>(2,2));
-
-    tf::Vector3 marker_tf_tran(marker_translation.at<float>(0,0),
-                               marker_translation.at<float>(1,0),
-                               marker_translation.at<float>(2,0));
-
-    return tf::Transform(marker_tf_rot, marker_tf_tran);
+    // Intrinsics of scaled and cropped image, calculated once for each configuration
+    if(scale.x!=scale.y)
+        ROS_WARN("Aspect of image differs from calibration, scale %f x %f of binning is used, crop of sensor needs own calibration",
+                 scale.x, scale.y);
+    cameraScale=scale;
+    cameraCrop=crop;
+    const CameraModel &model=cameraModels.model(scale,crop);
+    arucoCalibParams=model.parameters;
+
+    // Camera model of pose solver
+    poseSolver.set_camera(model.cameraMatrix,model.distortion);
+
+    // Tracked corners are in pixels of previous resolution
+    markerTracker.request_detection();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -755,6 +1181,8 @@ ViewPoint_Estimator::load_calibration_file(std::string filename)
         //# oST version 5.0 parameters
         string camera_matrix_str("camera matrix");
         string distortion_str("distortion");
+        string width_str("width");
+        string height_str("height");
 
         // Object of reading file
         ifstream file;
@@ -763,7 +1191,7 @@ ViewPoint_Estimator::load_calibration_file(std::string filename)
         // Alocation of memory
         intrinsics=new(cv::Mat)(3,3,CV_64F);
         distortion_coeff=new(cv::Mat)(5,1,CV_64F);
-        image_size=new(cv::Size);
+        image_size=new(cv::Size)(0,0);
 
         //  Reading of calibration file lines
         std::string line;
@@ -778,6 +1206,11 @@ ViewPoint_Estimator::load_calibration_file(std::string filename)
                         file >> intrinsics->at<double>(i,j);
                 std::cout << "Intrinsics:" << std::endl << *intrinsics << std::endl;
             }
+            // Size of calibration image, section [image]
+            if(line==width_str)
+                file >> image_size->width;
+            if(line==height_str)
+                file >> image_size->height;
             // Distortion 5x1
             if(line==distortion_str)
             {
@@ -787,7 +1220,10 @@ ViewPoint_Estimator::load_calibration_file(std::string filename)
             }
             line_counter++;
         }
-        arucoCalibParams.setParams(*intrinsics, *distortion_coeff, *image_size);
+        if(image_size->width>0)
+            std::cout << "Image size: " << image_size->width << "x" << image_size->height << std::endl;
+        cameraModels.set_calibration(*intrinsics,*distortion_coeff,*image_size);
+        update_camera_model(cv::Point2d(1.0,1.0),cv::Rect(0,0,image_size->width,image_size->height));
         if ((intrinsics->at<double>(2,2)==1)&&(distortion_coeff->at<double>(0,4)==0))
             ROS_INFO_STREAM("Calibration file loaded successfully");
         else
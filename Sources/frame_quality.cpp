@@ -0,0 +1,143 @@
+/*********************************************************************************************//**
+* @file frame_quality.cpp
+*
+* Sharpness and exposure check of images on subsampled grid source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <frame_quality.h>
+
+// Standarc C++ libraries
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Intensity of saturated and black pixels
+#define FRAME_QUALITY_SATURATED 250
+#define FRAME_QUALITY_DARK 5
+// Weight of actual image in reference sharpness, reference follows slow changes of scene
+#define FRAME_QUALITY_REFERENCE_WEIGHT 0.05
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameQualityGate::FrameQualityGate() :
+    step(4),                                             // every 4th pixel of every 4th row
+    minSharpness(0),                                     // no absolute limit
+    sharpnessRatio(0.5),                                 // half of reference sharpness
+    maxSaturated(0.2),                                   // 20% of saturated pixels
+    maxDark(0.5),                                        // 50% of black pixels
+    referenceSharpness(0)                                // no previous image
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+FrameQualityGate::set_step(int paramStep)
+{
+    step=(paramStep<1)?1:paramStep;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+FrameQualityGate::set_limits(double paramMinSharpness, double paramSharpnessRatio, double paramMaxSaturated, double paramMaxDark)
+{
+    minSharpness=paramMinSharpness;
+    sharpnessRatio=paramSharpnessRatio;
+    maxSaturated=paramMaxSaturated;
+    maxDark=paramMaxDark;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+FrameQualityGate::measure(const cv::Mat &image, FrameQuality &quality) const
+{
+    quality.mean=0;
+    quality.sharpness=0;
+    quality.saturated=0;
+    quality.dark=0;
+    if((image.rows<2)||(image.cols<2))
+        return;
+
+    // Sums of rows are integer, inner loop has no branches and compiler can vectorize it
+    int64_t sum=0,gradient=0,saturated=0,dark=0,count=0;
+    for(int y=0;y+1<image.rows;y+=step)
+    {
+        const uchar *row=image.ptr<uchar>(y);
+        const uchar *next=image.ptr<uchar>(y+1);
+        int32_t rowSum=0,rowSaturated=0,rowDark=0,rowCount=0;
+        int64_t rowGradient=0;
+        for(int x=0;x+1<image.cols;x+=step)
+        {
+            const int32_t value=row[x];
+            const int32_t dx=row[x+1]-value;
+            const int32_t dy=next[x]-value;
+            rowSum+=value;
+            rowGradient+=dx*dx+dy*dy;
+            rowSaturated+=(value>=FRAME_QUALITY_SATURATED);
+            rowDark+=(value<=FRAME_QUALITY_DARK);
+            rowCount++;
+        }
+        sum+=rowSum;
+        gradient+=rowGradient;
+        saturated+=rowSaturated;
+        dark+=rowDark;
+        count+=rowCount;
+    }
+
+    quality.mean=(double)sum/count;
+    quality.sharpness=(double)gradient/count;
+    quality.saturated=(double)saturated/count;
+    quality.dark=(double)dark/count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+FrameQualityGate::accept(const FrameQuality &quality)
+{
+    bool accepted=(quality.saturated<=maxSaturated)&&(quality.dark<=maxDark)&&(quality.sharpness>=minSharpness);
+    if(referenceSharpness>0)
+        accepted=accepted&&(quality.sharpness>=sharpnessRatio*referenceSharpness);
+
+    // Reference is updated by every image, permanent change of scene is accepted after a while
+    if(referenceSharpness>0)
+        referenceSharpness+=FRAME_QUALITY_REFERENCE_WEIGHT*(quality.sharpness-referenceSharpness);
+    else
+        referenceSharpness=quality.sharpness;
+
+    return accepted;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,192 @@
+/*********************************************************************************************//**
+* @file luma_ingest.cpp
+*
+* Gray image from raw Bayer and YUV image messages source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <luma_ingest.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+LumaIngest::LumaIngest() :
+    bayerMode(BAYER_FULL),                               // full resolution of Bayer by cv_bridge
+    lastScale(1.0)                                       // full resolution
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+LumaIngest::set_bayer_mode(BayerMode mode)
+{
+    bayerMode=mode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+LumaIngest::ingest(const sensor_msgs::Image &message, cv::Mat &luma)
+{
+    namespace enc=sensor_msgs::image_encodings;
+    const std::string &encoding=message.encoding;
+    lastScale=1.0;
+
+    if((message.width<2)||(message.height<2)||(message.data.empty()==true))
+        return false;
+
+    // Mono8 and Y plane of planar YUV 4:2:0 are used directly from message, without copy
+    if((encoding==enc::MONO8)||(encoding=="nv12")||(encoding=="nv21")||(encoding=="i420")||(encoding=="yv12"))
+    {
+        // Step of Y plane is width, if it is not given by message
+        const size_t step=((encoding==enc::MONO8)||(message.step>0))?message.step:message.width;
+        if(valid_size(message,step,1)==false)
+            return false;
+        luma=cv::Mat(message.height,message.width,CV_8UC1,const_cast<uchar*>(&message.data[0]),step);
+        return true;
+    }
+
+    // Packed YUV 4:2:2 - UYVY or YUYV, every second byte is luma
+    if(encoding==enc::YUV422)
+    {
+        if(packed_yuv(message,1)==false)
+            return false;
+        luma=buffer;
+        return true;
+    }
+    if((encoding=="yuv422_yuy2")||(encoding=="yuyv"))
+    {
+        if(packed_yuv(message,0)==false)
+            return false;
+        luma=buffer;
+        return true;
+    }
+
+    // Bayer 8 bit, half resolution
+    if(bayerMode==BAYER_FULL)
+        return false;
+    int firstGreen;
+    if((encoding==enc::BAYER_RGGB8)||(encoding==enc::BAYER_BGGR8))
+        firstGreen=1;
+    else if((encoding==enc::BAYER_GBRG8)||(encoding==enc::BAYER_GRBG8))
+        firstGreen=0;
+    else
+        return false;
+
+    const bool converted=(bayerMode==BAYER_HALF_GREEN)?bayer_green(message,firstGreen):bayer_gray(message);
+    if(converted==false)
+        return false;
+    luma=buffer;
+    lastScale=0.5;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+LumaIngest::valid_size(const sensor_msgs::Image &message, size_t step, int bytesPerPixel) const
+{
+    // Row has to contain all pixels and data has to contain all rows
+    if(step<(size_t)message.width*bytesPerPixel)
+        return false;
+    return message.data.size()>=step*message.height;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+LumaIngest::packed_yuv(const sensor_msgs::Image &message, int lumaOffset)
+{
+    if(valid_size(message,message.step,2)==false)
+        return false;
+    const int width=message.width;
+    const int height=message.height;
+    buffer.create(height,width,CV_8UC1);
+    for(int y=0;y<height;y++)
+    {
+        const uchar *source=&message.data[y*message.step]+lumaOffset;
+        uchar *destination=buffer.ptr<uchar>(y);
+        for(int x=0;x<width;x++)
+            destination[x]=source[2*x];
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+LumaIngest::bayer_green(const sensor_msgs::Image &message, int firstGreen)
+{
+    // Only complete 2x2 cells
+    if((valid_size(message,message.step,1)==false)||(message.width%2!=0)||(message.height%2!=0))
+        return false;
+
+    // Green pixels are on diagonal of 2x2 cell - columns firstGreen in first row and 1-firstGreen in second row
+    const int width=message.width/2;
+    const int height=message.height/2;
+    buffer.create(height,width,CV_8UC1);
+    for(int y=0;y<height;y++)
+    {
+        const uchar *row0=&message.data[(2*y)*message.step]+firstGreen;
+        const uchar *row1=&message.data[(2*y+1)*message.step]+(1-firstGreen);
+        uchar *destination=buffer.ptr<uchar>(y);
+        for(int x=0;x<width;x++)
+            destination[x]=(uchar)((row0[2*x]+row1[2*x]+1)>>1);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+LumaIngest::bayer_gray(const sensor_msgs::Image &message)
+{
+    // Only complete 2x2 cells
+    if((valid_size(message,message.step,1)==false)||(message.width%2!=0)||(message.height%2!=0))
+        return false;
+
+    // Mean of cell - weights 0.25 R, 0.5 G and 0.25 B for every Bayer pattern
+    const int width=message.width/2;
+    const int height=message.height/2;
+    buffer.create(height,width,CV_8UC1);
+    for(int y=0;y<height;y++)
+    {
+        const uchar *row0=&message.data[(2*y)*message.step];
+        const uchar *row1=&message.data[(2*y+1)*message.step];
+        uchar *destination=buffer.ptr<uchar>(y);
+        for(int x=0;x<width;x++)
+            destination[x]=(uchar)((row0[2*x]+row0[2*x+1]+row1[2*x]+row1[2*x+1]+2)>>2);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,198 @@
+/*********************************************************************************************//**
+* @file marker_id_filter.cpp
+*
+* Whitelist of accepted ArUco marker IDs source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+#include <marker_id_filter.h>
+
+// Standarc C++ libraries
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+MarkerIdFilter::MarkerIdFilter() :
+    mask(MARKER_ID_FILTER_SIZE,1)                        // all IDs are accepted by default
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerIdFilter::accept_all()
+{
+    for(int i=0;i<MARKER_ID_FILTER_SIZE;i++)
+        mask[i]=1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerIdFilter::reject_all()
+{
+    for(int i=0;i<MARKER_ID_FILTER_SIZE;i++)
+        mask[i]=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MarkerIdFilter::accept_list(const std::string &spec)
+{
+    std::stringstream specStream(spec);
+    std::string item;
+
+    // Items are separated by comma - "ID", "FIRST-LAST" or "FIRST-LAST:STEP"
+    while(std::getline(specStream,item,','))
+    {
+        // Empty items and spaces are ignored
+        std::string token;
+        for(size_t i=0;i<item.size();i++)
+        {
+            if(item[i]!=' ')
+                token+=item[i];
+        }
+        if(token.empty())
+            continue;
+
+        int first,last,step=1;
+        char *end;
+        first=(int)std::strtol(token.c_str(),&end,10);
+        last=first;
+        if(*end=='-')
+            last=(int)std::strtol(end+1,&end,10);
+        if(*end==':')
+            step=(int)std::strtol(end+1,&end,10);
+
+        if((*end!='\0')||(step<1)||(first>last))
+        {
+            std::cout << "Wrong item of marker ID filter: " << token << std::endl;
+            return false;
+        }
+
+        for(int id=first;id<=last;id+=step)
+        {
+            if((id>=0)&&(id<MARKER_ID_FILTER_SIZE))
+                mask[id]=1;
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MarkerIdFilter::load_file(const std::string &filename)
+{
+    std::ifstream file(filename.c_str());
+    if(!file.is_open())
+    {
+        std::cout << "Marker ID filter file can not be opened: " << filename << std::endl;
+        return false;
+    }
+
+    // Reading of bitset, ID is given by position of character
+    int id=0;
+    std::string line;
+    while(getline(file,line)&&(id<MARKER_ID_FILTER_SIZE))
+    {
+        for(size_t i=0;(i<line.size())&&(id<MARKER_ID_FILTER_SIZE);i++)
+        {
+            if(line[i]=='#')
+                break;
+            if(line[i]=='1')
+                mask[id++]=1;
+            else if(line[i]=='0')
+                mask[id++]=0;
+        }
+    }
+    std::cout << "Marker ID filter loaded from: " << filename << " (" << id << " IDs)" << std::endl;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MarkerIdFilter::setup(const std::string &spec, const std::string &filename)
+{
+    reject_all();
+    bool fileFailed=false;
+    if(filename.empty()==false)
+    {
+        if(load_file(filename)==true)
+            return true;
+        std::cout << "Marker ID filter falls back to list: " << spec << std::endl;
+        fileFailed=true;
+    }
+    if(accept_list(spec)==true)
+        return fileFailed==false;
+
+    // Part of wrong list can be already accepted
+    reject_all();
+    accept_list(MARKER_ID_FILTER_DEFAULT);
+    std::cout << "Marker ID filter falls back to default: " << MARKER_ID_FILTER_DEFAULT << std::endl;
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerIdFilter::filter(std::vector<aruco::Marker> &markers) const
+{
+    size_t accepted_count=0;
+    for(size_t i=0;i<markers.size();i++)
+    {
+        if(accepted(markers[i].id))
+        {
+            if(accepted_count!=i)
+                markers[accepted_count]=markers[i];
+            accepted_count++;
+        }
+    }
+    markers.resize(accepted_count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+MarkerIdFilter::count() const
+{
+    int accepted_count=0;
+    for(int i=0;i<MARKER_ID_FILTER_SIZE;i++)
+        accepted_count+=mask[i];
+    return accepted_count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,139 @@
+/*********************************************************************************************//**
+* @file marker_map_index.cpp
+*
+* Spatial index of mapped ArUco markers source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <marker_map_index.h>
+
+// Standarc C++ libraries
+#include <limits>
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+MarkerMapIndex::MarkerMapIndex(double paramCellSize) :
+    cellSize(paramCellSize),                             // size of grid cell in m
+    numberOfPositions(0)                                 // empty index
+{
+    if(cellSize<=0)
+        cellSize=2.0;
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapIndex::clear()
+{
+    idTable.clear();
+    grid.clear();
+    numberOfPositions=0;
+    for(int i=0;i<3;i++)
+    {
+        minCell[i]=std::numeric_limits<int>::max();
+        maxCell[i]=std::numeric_limits<int>::min();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapIndex::insert_id(int markerID, int index)
+{
+    if(markerID<0)
+        return;
+    if(markerID>=(int)idTable.size())
+        idTable.resize(markerID+1,-1);
+    idTable[markerID]=index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapIndex::insert_position(int index, double x, double y, double z)
+{
+    const int c[3]={cell(x),cell(y),cell(z)};
+
+    Entry entry;
+    entry.index=index;
+    entry.x=x;
+    entry.y=y;
+    entry.z=z;
+    grid[cell_key(c[0],c[1],c[2])].push_back(entry);
+    numberOfPositions++;
+
+    for(int i=0;i<3;i++)
+    {
+        minCell[i]=std::min(minCell[i],c[i]);
+        maxCell[i]=std::max(maxCell[i],c[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapIndex::query_radius(double x, double y, double z, double radius, std::vector<int> &indexes) const
+{
+    indexes.resize(0);
+    if(numberOfPositions==0)
+        return;
+
+    // Only cells overlapping with sphere are visited, limited by occupied cells
+    const int fromX=std::max(cell(x-radius),minCell[0]), toX=std::min(cell(x+radius),maxCell[0]);
+    const int fromY=std::max(cell(y-radius),minCell[1]), toY=std::min(cell(y+radius),maxCell[1]);
+    const int fromZ=std::max(cell(z-radius),minCell[2]), toZ=std::min(cell(z+radius),maxCell[2]);
+    const double radius2=radius*radius;
+
+    for(int cx=fromX;cx<=toX;cx++)
+    {
+        for(int cy=fromY;cy<=toY;cy++)
+        {
+            for(int cz=fromZ;cz<=toZ;cz++)
+            {
+                std::unordered_map<int64_t,std::vector<Entry> >::const_iterator it=grid.find(cell_key(cx,cy,cz));
+                if(it==grid.end())
+                    continue;
+                const std::vector<Entry> &entries=it->second;
+                for(size_t i=0;i<entries.size();i++)
+                {
+                    const double dx=entries[i].x-x, dy=entries[i].y-y, dz=entries[i].z-z;
+                    if(dx*dx+dy*dy+dz*dz<=radius2)
+                        indexes.push_back(entries[i].index);
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,175 @@
+/*********************************************************************************************//**
+* @file marker_map_snapshot.cpp
+*
+* Immutable versions of marker map shared without locks source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <marker_map_snapshot.h>
+
+// Standarc C++ libraries
+#include <iostream>
+#include <algorithm>
+#include <new>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+MarkerMapSnapshots::MarkerMapSnapshots(int paramMaxReaders) :
+    numberOfReaders(std::max(paramMaxReaders,1)),        // slots are allocated at once, count is never changed
+    readerMemory(NULL),                                  // allocated below
+    readers(NULL),                                       // allocated below
+    globalEpoch(1),                                      // epoch 0 means not reading
+    publishedVersion(0),                                 // no version
+    current(NULL)                                        // no map
+{
+    // Each slot starts at cache line, readers do not share lines with each other or with other data
+    const size_t alignment=alignof(ReaderSlot);
+    readerMemory=new char[numberOfReaders*sizeof(ReaderSlot)+alignment];
+    const uintptr_t address=reinterpret_cast<uintptr_t>(readerMemory);
+    readers=reinterpret_cast<ReaderSlot*>((address+alignment-1)&~(uintptr_t)(alignment-1));
+    for(int i=0;i<numberOfReaders;i++)
+    {
+        new (&readers[i]) ReaderSlot;
+        readers[i].epoch.store(0,std::memory_order_relaxed);
+        readers[i].used.store(false,std::memory_order_relaxed);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+MarkerMapSnapshots::~MarkerMapSnapshots()
+{
+    // Readers have to be finished
+    for(size_t i=0;i<retired.size();i++)
+        delete retired[i].second;
+    delete current.load(std::memory_order_relaxed);
+    for(int i=0;i<numberOfReaders;i++)
+        readers[i].~ReaderSlot();
+    delete[] readerMemory;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+MarkerMapSnapshots::register_reader()
+{
+    for(int i=0;i<numberOfReaders;i++)
+    {
+        bool expected=false;
+        if(readers[i].used.compare_exchange_strong(expected,true))
+            return i;
+    }
+    std::cout << "All reader slots of marker map are used" << std::endl;
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapSnapshots::unregister_reader(int reader)
+{
+    if((reader<0)||(reader>=numberOfReaders))
+        return;
+    readers[reader].epoch.store(0,std::memory_order_release);
+    readers[reader].used.store(false,std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+const MarkerMapSnapshot *
+MarkerMapSnapshots::acquire(int reader) const
+{
+    if((reader<0)||(reader>=numberOfReaders))
+        return NULL;
+
+    // Epoch is announced before loading of version, writer which retires loaded version
+    // increases epoch after its replacing, so it sees announced epoch not higher than epoch of retiring
+    readers[reader].epoch.store(globalEpoch.load(std::memory_order_seq_cst),std::memory_order_seq_cst);
+    return current.load(std::memory_order_seq_cst);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapSnapshots::release(int reader) const
+{
+    if((reader<0)||(reader>=numberOfReaders))
+        return;
+    readers[reader].epoch.store(0,std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapSnapshots::publish(MarkerMapSnapshot *snapshot)
+{
+    snapshot->version=publishedVersion.load(std::memory_order_relaxed)+1;
+    const MarkerMapSnapshot *old=current.exchange(snapshot,std::memory_order_seq_cst);
+    publishedVersion.store(snapshot->version,std::memory_order_release);
+
+    // Readers with epoch lower than new epoch can read old version
+    const uint64_t epoch=globalEpoch.fetch_add(1,std::memory_order_seq_cst)+1;
+    if(old!=NULL)
+        retired.push_back(std::make_pair(epoch,old));
+    reclaim();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerMapSnapshots::reclaim()
+{
+    if(retired.empty())
+        return;
+
+    // Lowest announced epoch of reading readers
+    uint64_t oldestEpoch=globalEpoch.load(std::memory_order_seq_cst);
+    for(int i=0;i<numberOfReaders;i++)
+    {
+        const uint64_t epoch=readers[i].epoch.load(std::memory_order_seq_cst);
+        if((epoch!=0)&&(epoch<oldestEpoch))
+            oldestEpoch=epoch;
+    }
+
+    // Version retired in epoch E can be read only by readers with epoch lower than E
+    size_t kept=0;
+    for(size_t i=0;i<retired.size();i++)
+    {
+        if(retired[i].first<=oldestEpoch)
+            delete retired[i].second;
+        else
+            retired[kept++]=retired[i];
+    }
+    retired.resize(kept);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,219 @@
+/*********************************************************************************************//**
+* @file marker_tracker.cpp
+*
+* Tracking of marker corners by pyramidal optical flow source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <marker_tracker.h>
+
+// Standarc C++ libraries
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Area of tracked marker can change between two images at most by this ratio
+#define MARKER_TRACKER_AREA_RATIO 1.5
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+MarkerTracker::MarkerTracker() :
+    interval(1),                                         // full detection in every image
+    imagesFromDetection(0),                              // no tracked image
+    detectionRequested(true),                            // no detected markers
+    windowSize(21,21),                                   // window of optical flow
+    levels(3),                                           // levels of pyramid
+    maxError(20.0),                                      // error of optical flow
+    backwardThreshold(1.0)                               // distance of forward-backward tracking
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::set_interval(int paramInterval)
+{
+    interval=(paramInterval<1)?1:paramInterval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::set_flow(int window, int paramLevels, double paramMaxError)
+{
+    windowSize=cv::Size(window,window);
+    levels=paramLevels;
+    maxError=paramMaxError;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::set_backward_threshold(double threshold)
+{
+    backwardThreshold=threshold;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::reset(const cv::Mat &image, const std::vector<aruco::Marker> &detected)
+{
+    markers=detected;
+    imagesFromDetection=0;
+    detectionRequested=false;
+
+    // Pyramid of actual image is previous pyramid of next tracking
+    if(markers.empty()==false)
+        build_pyramid(image,previousPyramid);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::build_pyramid(const cv::Mat &image, std::vector<cv::Mat> &pyramid) const
+{
+    // Image can share data with image message (Mono8 and YUV without copy, region of interest),
+    // so level 0 is always copied into pyramid, message is released before next tracking
+    cv::buildOpticalFlowPyramid(image,pyramid,windowSize,levels,true,cv::BORDER_REFLECT_101,cv::BORDER_CONSTANT,false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+MarkerTracker::request_detection()
+{
+    detectionRequested=true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MarkerTracker::track(const cv::Mat &image, std::vector<aruco::Marker> &tracked)
+{
+    // Full detection is due
+    imagesFromDetection++;
+    if((enabled()==false)||(detectionRequested==true)||(imagesFromDetection>=interval)||(markers.empty()==true))
+        return false;
+
+    // All corners are tracked at once
+    previousCorners.resize(0);
+    for(size_t i=0;i<markers.size();i++)
+        for(int k=0;k<4;k++)
+            previousCorners.push_back(markers[i][k]);
+
+    build_pyramid(image,actualPyramid);
+    cv::calcOpticalFlowPyrLK(previousPyramid,actualPyramid,previousCorners,actualCorners,status,errors,windowSize,levels);
+
+    // Tracking back to previous image, corners lost by occlusion or drift return to different position
+    if(backwardThreshold>0)
+    {
+        backwardCorners=previousCorners;
+        cv::calcOpticalFlowPyrLK(actualPyramid,previousPyramid,actualCorners,backwardCorners,backwardStatus,backwardErrors,
+                                 windowSize,levels,cv::TermCriteria(cv::TermCriteria::COUNT|cv::TermCriteria::EPS,30,0.01),
+                                 cv::OPTFLOW_USE_INITIAL_FLOW);
+    }
+
+    for(size_t p=0;p<previousCorners.size();p++)
+    {
+        bool valid=(status[p]!=0)&&(errors[p]<=maxError);
+        if((valid==true)&&(backwardThreshold>0))
+            valid=(backwardStatus[p]!=0)&&(cv::norm(backwardCorners[p]-previousCorners[p])<=backwardThreshold);
+        if(valid==false)
+            return false;
+    }
+
+    // Shape of every marker is checked
+    for(size_t i=0;i<markers.size();i++)
+    {
+        if(check_marker(&previousCorners[4*i],&actualCorners[4*i],image.size())==false)
+            return false;
+    }
+
+    // Output is copied only if it does not contain the same markers, usually after full detection
+    bool sameMarkers=(tracked.size()==markers.size());
+    for(size_t i=0;(sameMarkers==true)&&(i<markers.size());i++)
+        sameMarkers=(tracked[i].id==markers[i].id)&&(tracked[i].size()==4);
+    if(sameMarkers==false)
+        tracked=markers;
+
+    // Tracked markers are markers of next tracking, corners are overwritten in place
+    for(size_t i=0;i<markers.size();i++)
+    {
+        for(int k=0;k<4;k++)
+        {
+            markers[i][k]=actualCorners[4*i+k];
+            tracked[i][k]=actualCorners[4*i+k];
+        }
+    }
+    previousPyramid.swap(actualPyramid);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+MarkerTracker::check_marker(const cv::Point2f previous[4], const cv::Point2f actual[4], const cv::Size &size) const
+{
+    // Corners are in image, far enough from border for window of optical flow
+    const float marginX=windowSize.width/2.0f;
+    const float marginY=windowSize.height/2.0f;
+    for(int k=0;k<4;k++)
+    {
+        if((actual[k].x<marginX)||(actual[k].y<marginY)||(actual[k].x>size.width-marginX)||(actual[k].y>size.height-marginY))
+            return false;
+    }
+
+    // Quadrilateral is convex with the same orientation as before
+    double previousArea=0,actualArea=0;
+    double orientation=0;
+    for(int k=0;k<4;k++)
+    {
+        const cv::Point2f a=actual[(k+1)%4]-actual[k];
+        const cv::Point2f b=actual[(k+2)%4]-actual[(k+1)%4];
+        const double cross=a.x*b.y-a.y*b.x;
+        if((k>0)&&(cross*orientation<=0))
+            return false;
+        orientation=cross;
+
+        previousArea+=previous[k].x*previous[(k+1)%4].y-previous[(k+1)%4].x*previous[k].y;
+        actualArea+=actual[k].x*actual[(k+1)%4].y-actual[(k+1)%4].x*actual[k].y;
+    }
+    if(previousArea*actualArea<=0)
+        return false;
+
+    // Area does not change too much between two images
+    const double ratio=std::fabs(actualArea/previousArea);
+    return (ratio<=MARKER_TRACKER_AREA_RATIO)&&(ratio>=1.0/MARKER_TRACKER_AREA_RATIO);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,446 @@
+/*********************************************************************************************//**
+* @file planar_pose_solver.cpp
+*
+* Batched closed form pose solver of square planar markers source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <planar_pose_solver.h>
+
+// Standarc C++ libraries
+#include <cmath>
+#include <limits>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+PlanarPoseSolver::PlanarPoseSolver() :
+    fx(1),fy(1),cx(0),cy(0),                             // camera intrinsics
+    k1(0),k2(0),p1(0),p2(0),k3(0),                       // no distortion
+    ambiguityRatio(1.5),                                 // ambiguous solutions
+    previousMaxAge(5),                                   // previous rotation from last 5 images
+    imageCounter(1)                                      // 0 means no previous rotation
+{
+    set_marker_size(0.1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::set_camera(const double cameraMatrix[4], const double distortion[5])
+{
+    fx=cameraMatrix[0];
+    fy=cameraMatrix[1];
+    cx=cameraMatrix[2];
+    cy=cameraMatrix[3];
+    k1=distortion[0];
+    k2=distortion[1];
+    p1=distortion[2];
+    p2=distortion[3];
+    k3=distortion[4];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::set_marker_size(double paramMarkerSize)
+{
+    // Same corners as in aruco::Marker::calculateExtrinsics, marker plane is XY of solver
+    markerSize=paramMarkerSize;
+    const double halfSize=markerSize/2.0;
+    objectX[0]=-halfSize; objectY[0]=-halfSize;
+    objectX[1]=-halfSize; objectY[1]=halfSize;
+    objectX[2]=halfSize;  objectY[2]=halfSize;
+    objectX[3]=halfSize;  objectY[3]=-halfSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::set_ambiguity_ratio(double ratio)
+{
+    ambiguityRatio=ratio;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::set_previous_max_age(int images)
+{
+    previousMaxAge=(images<1)?1:images;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::solve(const std::vector<aruco::Marker> &markers, std::vector<MarkerPose> &poses)
+{
+    imageCounter++;
+    poses.resize(markers.size());
+    for(size_t i=0;i<markers.size();i++)
+    {
+        poses[i].valid=false;
+        if(markers[i].size()!=4)
+            continue;
+        const cv::Point2f corners[4]={markers[i][0],markers[i][1],markers[i][2],markers[i][3]};
+        solve_marker(markers[i].id,corners,poses[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+PlanarPoseSolver::solve_marker(int markerID, const cv::Point2f corners[4], MarkerPose &pose)
+{
+    pose.valid=false;
+
+    // Normalized image coordinates of corners
+    double x[4],y[4];
+    for(int i=0;i<4;i++)
+        undistort(corners[i],x[i],y[i]);
+
+    // Homography from marker plane to normalized image
+    double H[9];
+    if(homography(x,y,H)==false)
+        return false;
+
+    // Two possible rotations and their translations
+    double R1[9],R2[9],t1[3],t2[3];
+    rotations(H,R1,R2);
+    translation(R1,x,y,t1);
+    translation(R2,x,y,t2);
+    const double error1=reprojection_error(R1,t1,x,y);
+    const double error2=reprojection_error(R2,t2,x,y);
+
+    // Solution with lower reprojection error
+    bool first=(error1<=error2);
+
+    // Ambiguous solutions, the closer one to rotation from previous image is used
+    const double errorMin=std::min(error1,error2);
+    const double errorMax=std::max(error1,error2);
+    // Rotation of marker lost long time ago can be far from actual rotation and it would keep wrong solution
+    const bool known=(markerID>=0)&&(markerID<(int)previousImage.size())&&(previousImage[markerID]!=0)&&
+                     (imageCounter-previousImage[markerID]<=(unsigned int)previousMaxAge);
+    if((known==true)&&(errorMax<ambiguityRatio*errorMin+1e-6))
+    {
+        const double *previous=&previousRotation[9*markerID];
+        double trace1=0,trace2=0;
+        for(int k=0;k<9;k++)
+        {
+            trace1+=previous[k]*R1[k];
+            trace2+=previous[k]*R2[k];
+        }
+        first=(trace1>=trace2);
+    }
+
+    const double *R=first ? R1 : R2;
+    const double *t=first ? t1 : t2;
+    // Rotation around X by +90 deg like aruco::Marker::rotateXAxis, Y is perpendicular to marker plane
+    // Columns of R*Rx(90) are first, third and negative second column of R
+    for(int r=0;r<3;r++)
+    {
+        pose.R[3*r]=R[3*r];
+        pose.R[3*r+1]=R[3*r+2];
+        pose.R[3*r+2]=-R[3*r+1];
+    }
+    for(int k=0;k<3;k++)
+        pose.t[k]=t[k];
+    pose.error=first ? error1 : error2;
+    pose.valid=(t[2]>0)&&(pose.error==pose.error);
+
+    // Temporal context for next image
+    if((pose.valid==true)&&(markerID>=0))
+    {
+        if(markerID>=(int)previousImage.size())
+        {
+            previousImage.resize(markerID+1,0);
+            previousRotation.resize(9*(markerID+1),0);
+        }
+        // Rotation in marker plane frame, solutions of next image are compared with it
+        for(int k=0;k<9;k++)
+            previousRotation[9*markerID+k]=R[k];
+        previousImage[markerID]=imageCounter;
+    }
+    return pose.valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::undistort(const cv::Point2f &pixel, double &x, double &y) const
+{
+    // Iterative inversion of distortion model as in cv::undistortPoints, more iterations for wide lenses
+    const double x0=(pixel.x-cx)/fx;
+    const double y0=(pixel.y-cy)/fy;
+    x=x0;
+    y=y0;
+    for(int i=0;i<10;i++)
+    {
+        const double r2=x*x+y*y;
+        const double icdist=1.0/(1.0+((k3*r2+k2)*r2+k1)*r2);
+        const double deltaX=2.0*p1*x*y+p2*(r2+2.0*x*x);
+        const double deltaY=p1*(r2+2.0*y*y)+2.0*p2*x*y;
+        x=(x0-deltaX)*icdist;
+        y=(y0-deltaY)*icdist;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+PlanarPoseSolver::homography(const double x[4], const double y[4], double H[9]) const
+{
+    // Linear system 8x8 for H with H[8]=1, Gaussian elimination with partial pivoting
+    double A[8][9];
+    for(int i=0;i<4;i++)
+    {
+        const double X=objectX[i];
+        const double Y=objectY[i];
+        double *rowX=A[2*i];
+        double *rowY=A[2*i+1];
+        rowX[0]=X; rowX[1]=Y; rowX[2]=1; rowX[3]=0; rowX[4]=0; rowX[5]=0; rowX[6]=-x[i]*X; rowX[7]=-x[i]*Y; rowX[8]=x[i];
+        rowY[0]=0; rowY[1]=0; rowY[2]=0; rowY[3]=X; rowY[4]=Y; rowY[5]=1; rowY[6]=-y[i]*X; rowY[7]=-y[i]*Y; rowY[8]=y[i];
+    }
+
+    for(int col=0;col<8;col++)
+    {
+        int pivot=col;
+        for(int row=col+1;row<8;row++)
+        {
+            if(std::fabs(A[row][col])>std::fabs(A[pivot][col]))
+                pivot=row;
+        }
+        if(std::fabs(A[pivot][col])<1e-12)
+            return false;
+        if(pivot!=col)
+        {
+            for(int k=col;k<9;k++)
+                std::swap(A[pivot][k],A[col][k]);
+        }
+        for(int row=col+1;row<8;row++)
+        {
+            const double factor=A[row][col]/A[col][col];
+            for(int k=col;k<9;k++)
+                A[row][k]-=factor*A[col][k];
+        }
+    }
+    for(int row=7;row>=0;row--)
+    {
+        double sum=A[row][8];
+        for(int k=row+1;k<8;k++)
+            sum-=A[row][k]*H[k];
+        H[row]=sum/A[row][row];
+    }
+    H[8]=1.0;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::rotations(const double H[9], double R1[9], double R2[9]) const
+{
+    // Image of marker centre and Jacobian of homography in marker centre
+    const double p=H[2];
+    const double q=H[5];
+    const double j00=H[0]-H[6]*p;
+    const double j01=H[1]-H[7]*p;
+    const double j10=H[3]-H[6]*q;
+    const double j11=H[4]-H[7]*q;
+
+    // Rotation Rv, which rotates Z axis to ray of marker centre
+    double Rv[9];
+    {
+        const double norm=std::sqrt(p*p+q*q+1.0);
+        const double ax=p/norm, ay=q/norm, az=1.0/norm;
+        const double d=1.0/(1.0+az);
+        Rv[0]=1.0-ax*ax*d; Rv[1]=-ax*ay*d;     Rv[2]=ax;
+        Rv[3]=-ax*ay*d;    Rv[4]=1.0-ay*ay*d;  Rv[5]=ay;
+        Rv[6]=-ax;         Rv[7]=-ay;          Rv[8]=1.0-(ax*ax+ay*ay)*d;
+    }
+
+    // Jacobian in frame of ray
+    const double b00=Rv[0]-p*Rv[6];
+    const double b01=Rv[1]-p*Rv[7];
+    const double b10=Rv[3]-q*Rv[6];
+    const double b11=Rv[4]-q*Rv[7];
+    const double dtinv=1.0/(b00*b11-b01*b10);
+    const double binv00=dtinv*b11;
+    const double binv01=-dtinv*b01;
+    const double binv10=-dtinv*b10;
+    const double binv11=dtinv*b00;
+    const double a00=binv00*j00+binv01*j10;
+    const double a01=binv00*j01+binv01*j11;
+    const double a10=binv10*j00+binv11*j10;
+    const double a11=binv10*j01+binv11*j11;
+
+    // Largest singular value of A
+    const double ata00=a00*a00+a01*a01;
+    const double ata01=a00*a10+a01*a11;
+    const double ata11=a10*a10+a11*a11;
+    const double gamma=std::sqrt(0.5*(ata00+ata11+std::sqrt((ata00-ata11)*(ata00-ata11)+4.0*ata01*ata01)));
+
+    // Upper left 2x2 block of rotation and two possible completions
+    const double r00=a00/gamma, r01=a01/gamma;
+    const double r10=a10/gamma, r11=a11/gamma;
+    const double b0=std::sqrt(std::max(0.0,1.0-r00*r00-r10*r10));
+    double b1=std::sqrt(std::max(0.0,1.0-r01*r01-r11*r11));
+    if(-r00*r01-r10*r11<0)
+        b1=-b1;
+
+    for(int solution=0;solution<2;solution++)
+    {
+        const double sign=(solution==0) ? 1.0 : -1.0;
+        // Columns of rotation in frame of ray, third column is cross product
+        const double c0[3]={r00,r10,sign*b0};
+        const double c1[3]={r01,r11,sign*b1};
+        const double c2[3]={c0[1]*c1[2]-c0[2]*c1[1],c0[2]*c1[0]-c0[0]*c1[2],c0[0]*c1[1]-c0[1]*c1[0]};
+        double *R=(solution==0) ? R1 : R2;
+        // R = Rv * [c0 c1 c2]
+        for(int row=0;row<3;row++)
+        {
+            const double v0=Rv[3*row], v1=Rv[3*row+1], v2=Rv[3*row+2];
+            R[3*row+0]=v0*c0[0]+v1*c0[1]+v2*c0[2];
+            R[3*row+1]=v0*c1[0]+v1*c1[1]+v2*c1[2];
+            R[3*row+2]=v0*c2[0]+v1*c2[1]+v2*c2[2];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::translation(const double R[9], const double x[4], const double y[4], double t[3]) const
+{
+    // Least squares of x*(Rz+tz)=Rx+tx and y*(Rz+tz)=Ry+ty, normal equations 3x3
+    double ata[3][3]={{0,0,0},{0,0,0},{0,0,0}};
+    double atb[3]={0,0,0};
+    for(int i=0;i<4;i++)
+    {
+        const double qx=R[0]*objectX[i]+R[1]*objectY[i];
+        const double qy=R[3]*objectX[i]+R[4]*objectY[i];
+        const double qz=R[6]*objectX[i]+R[7]*objectY[i];
+        const double bx=x[i]*qz-qx;
+        const double by=y[i]*qz-qy;
+        ata[0][0]+=1;
+        ata[1][1]+=1;
+        ata[0][2]-=x[i];
+        ata[1][2]-=y[i];
+        ata[2][2]+=x[i]*x[i]+y[i]*y[i];
+        atb[0]+=bx;
+        atb[1]+=by;
+        atb[2]-=x[i]*bx+y[i]*by;
+    }
+    ata[2][0]=ata[0][2];
+    ata[2][1]=ata[1][2];
+
+    // Cramer's rule
+    const double det=ata[0][0]*(ata[1][1]*ata[2][2]-ata[1][2]*ata[2][1])
+                    -ata[0][1]*(ata[1][0]*ata[2][2]-ata[1][2]*ata[2][0])
+                    +ata[0][2]*(ata[1][0]*ata[2][1]-ata[1][1]*ata[2][0]);
+    for(int k=0;k<3;k++)
+    {
+        double m[3][3];
+        for(int row=0;row<3;row++)
+            for(int col=0;col<3;col++)
+                m[row][col]=(col==k) ? atb[row] : ata[row][col];
+        t[k]=(m[0][0]*(m[1][1]*m[2][2]-m[1][2]*m[2][1])
+             -m[0][1]*(m[1][0]*m[2][2]-m[1][2]*m[2][0])
+             +m[0][2]*(m[1][0]*m[2][1]-m[1][1]*m[2][0]))/det;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+double
+PlanarPoseSolver::reprojection_error(const double R[9], const double t[3], const double x[4], const double y[4]) const
+{
+    double sum=0;
+    for(int i=0;i<4;i++)
+    {
+        const double qx=R[0]*objectX[i]+R[1]*objectY[i]+t[0];
+        const double qy=R[3]*objectX[i]+R[4]*objectY[i]+t[1];
+        const double qz=R[6]*objectX[i]+R[7]*objectY[i]+t[2];
+        const double dx=(qx/qz-x[i])*fx;
+        const double dy=(qy/qz-y[i])*fy;
+        sum+=dx*dx+dy*dy;
+    }
+    return std::sqrt(sum/4.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PlanarPoseSolver::rotation_to_rvec(const double R[9], double rvec[3])
+{
+    const double cosine=std::max(-1.0,std::min(1.0,0.5*(R[0]+R[4]+R[8]-1.0)));
+    const double theta=std::acos(cosine);
+
+    // Small rotation
+    if(theta<1e-9)
+    {
+        rvec[0]=rvec[1]=rvec[2]=0;
+        return;
+    }
+    // Rotation close to 180 degrees, axis from symmetric part k*k^T=(R+R^T)/2-cos*I)/(1-cos)
+    if(theta>3.0)
+    {
+        const double scale=1.0/(1.0-cosine);
+        const double kk[9]={(R[0]-cosine)*scale,0.5*(R[1]+R[3])*scale,0.5*(R[2]+R[6])*scale,
+                            0.5*(R[1]+R[3])*scale,(R[4]-cosine)*scale,0.5*(R[5]+R[7])*scale,
+                            0.5*(R[2]+R[6])*scale,0.5*(R[5]+R[7])*scale,(R[8]-cosine)*scale};
+        // Row with the largest diagonal element is the most accurate
+        int row=0;
+        if(kk[4]>kk[3*row+row])
+            row=1;
+        if(kk[8]>kk[3*row+row])
+            row=2;
+        const double norm=std::sqrt(kk[3*row+row]);
+        double axis[3]={kk[3*row]/norm,kk[3*row+1]/norm,kk[3*row+2]/norm};
+        // Sign of axis from antisymmetric part
+        if(axis[0]*(R[7]-R[5])+axis[1]*(R[2]-R[6])+axis[2]*(R[3]-R[1])<0)
+        {
+            axis[0]=-axis[0];
+            axis[1]=-axis[1];
+            axis[2]=-axis[2];
+        }
+        rvec[0]=axis[0]*theta;
+        rvec[1]=axis[1]*theta;
+        rvec[2]=axis[2]*theta;
+        return;
+    }
+    const double factor=theta/(2.0*std::sin(theta));
+    rvec[0]=(R[7]-R[5])*factor;
+    rvec[1]=(R[2]-R[6])*factor;
+    rvec[2]=(R[3]-R[1])*factor;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,211 @@
+/*********************************************************************************************//**
+* @file pose_history.cpp
+*
+* Ring buffer of global positions with interpolation in time source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <pose_history.h>
+
+// Standarc C++ libraries
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+PoseHistory::PoseHistory(size_t paramCapacity, uint64_t paramMaxGap) :
+    capacity((paramCapacity<2)?2:paramCapacity),         // at least two positions for interpolation
+    maxGap(paramMaxGap),                                 // 0 - any gap
+    slots(capacity),                                     // all slots are allocated at once
+    written(0),                                          // empty history
+    lastStamp(0)                                         // no position
+{
+    for(size_t i=0;i<capacity;i++)
+        slots[i].sequence.store(0,std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+PoseHistory::push(uint64_t stamp, const RigidTransform &transform)
+{
+    const uint64_t index=written.load(std::memory_order_relaxed);
+    if((index>0)&&(stamp<=lastStamp))
+        return;
+    lastStamp=stamp;
+
+    Slot &slot=slots[index%capacity];
+    const uint32_t sequence=slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.index=index;
+    slot.entry.stamp=stamp;
+    slot.entry.position[0]=transform.t[0];
+    slot.entry.position[1]=transform.t[1];
+    slot.entry.position[2]=transform.t[2];
+    rigid_to_quaternion(transform,slot.entry.orientation);
+
+    slot.sequence.store(sequence+2,std::memory_order_release);
+    written.store(index+1,std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t
+PoseHistory::size() const
+{
+    const uint64_t count=written.load(std::memory_order_acquire);
+    return (count<capacity)?(size_t)count:capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+PoseHistory::read_slot(uint64_t index, PoseHistoryEntry &entry) const
+{
+    const Slot &slot=slots[index%capacity];
+    uint32_t before,after;
+    uint64_t slotIndex;
+    do
+    {
+        before=slot.sequence.load(std::memory_order_acquire);
+        slotIndex=slot.index;
+        entry=slot.entry;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after=slot.sequence.load(std::memory_order_relaxed);
+    }
+    while((before!=after)||((before&1)!=0));
+
+    // Slot was overwritten by newer position
+    return slotIndex==index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+PoseHistory::SearchResult
+PoseHistory::search(uint64_t stamp, PoseHistoryEntry &first, PoseHistoryEntry &second) const
+{
+    const uint64_t count=written.load(std::memory_order_acquire);
+    if(count==0)
+        return SEARCH_OUT;
+
+    // Binary search of last position not newer than given time
+    uint64_t low=(count>capacity)?count-capacity:0;
+    uint64_t high=count-1;
+    if((read_slot(low,first)==false)||(read_slot(high,second)==false))
+        return SEARCH_OVERWRITTEN;
+    if((stamp<first.stamp)||(stamp>second.stamp))
+        return SEARCH_OUT;
+    if(stamp==second.stamp)
+    {
+        first=second;
+        return SEARCH_FOUND;
+    }
+
+    while(high-low>1)
+    {
+        const uint64_t middle=low+(high-low)/2;
+        PoseHistoryEntry middleEntry;
+        if(read_slot(middle,middleEntry)==false)
+            return SEARCH_OVERWRITTEN;
+        if(middleEntry.stamp<=stamp)
+        {
+            low=middle;
+            first=middleEntry;
+        }
+        else
+        {
+            high=middle;
+            second=middleEntry;
+        }
+    }
+    return SEARCH_FOUND;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+PoseHistory::query(uint64_t stamp, PoseHistoryEntry &entry) const
+{
+    // Search is repeated from actual count of positions, if writer overwrote some of read slots
+    PoseHistoryEntry first,second;
+    SearchResult result=SEARCH_OVERWRITTEN;
+    for(int attempt=0;(attempt<POSE_HISTORY_MAX_RETRIES)&&(result==SEARCH_OVERWRITTEN);attempt++)
+        result=search(stamp,first,second);
+    if(result!=SEARCH_FOUND)
+        return false;
+    if(first.stamp==second.stamp)
+    {
+        entry=first;
+        return true;
+    }
+
+    // Position is unknown between positions too far in time - lost markers, stationary skip...
+    if((maxGap>0)&&(second.stamp-first.stamp>maxGap))
+        return false;
+
+    // Linear interpolation of position and spherical interpolation of orientation
+    const double ratio=(double)(stamp-first.stamp)/(double)(second.stamp-first.stamp);
+    entry.stamp=stamp;
+    for(int k=0;k<3;k++)
+        entry.position[k]=first.position[k]+ratio*(second.position[k]-first.position[k]);
+
+    double cosine=0;
+    for(int k=0;k<4;k++)
+        cosine+=first.orientation[k]*second.orientation[k];
+    // Shorter path between orientations
+    const double sign=(cosine<0)?-1.0:1.0;
+    cosine*=sign;
+
+    double weightFirst=1.0-ratio;
+    double weightSecond=ratio;
+    if(cosine<0.9995)
+    {
+        const double angle=std::acos(cosine);
+        const double sine=std::sin(angle);
+        weightFirst=std::sin((1.0-ratio)*angle)/sine;
+        weightSecond=std::sin(ratio*angle)/sine;
+    }
+    double norm=0;
+    for(int k=0;k<4;k++)
+    {
+        entry.orientation[k]=weightFirst*first.orientation[k]+weightSecond*sign*second.orientation[k];
+        norm+=entry.orientation[k]*entry.orientation[k];
+    }
+    norm=std::sqrt(norm);
+    for(int k=0;k<4;k++)
+        entry.orientation[k]/=norm;
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
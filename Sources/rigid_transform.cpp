@@ -0,0 +1,345 @@
+/*********************************************************************************************//**
+* @file rigid_transform.cpp
+*
+* Fixed size rigid transforms and batched operations over structure of arrays source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <rigid_transform.h>
+
+// Standarc C++ libraries
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_identity(RigidTransform &T)
+{
+    for(int k=0;k<9;k++)
+        T.R[k]=((k%4)==0)?1.0:0.0;
+    T.t[0]=0;
+    T.t[1]=0;
+    T.t[2]=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_compose(const RigidTransform &A, const RigidTransform &B, RigidTransform &C)
+{
+    for(int r=0;r<3;r++)
+    {
+        const double a0=A.R[3*r],a1=A.R[3*r+1],a2=A.R[3*r+2];
+        C.R[3*r]  =a0*B.R[0]+a1*B.R[3]+a2*B.R[6];
+        C.R[3*r+1]=a0*B.R[1]+a1*B.R[4]+a2*B.R[7];
+        C.R[3*r+2]=a0*B.R[2]+a1*B.R[5]+a2*B.R[8];
+        C.t[r]=a0*B.t[0]+a1*B.t[1]+a2*B.t[2]+A.t[r];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_invert(const RigidTransform &A, RigidTransform &B)
+{
+    // Rotation is transposed, translation is -R^T*t
+    for(int r=0;r<3;r++)
+    {
+        B.R[3*r]  =A.R[r];
+        B.R[3*r+1]=A.R[3+r];
+        B.R[3*r+2]=A.R[6+r];
+        B.t[r]=-(A.R[r]*A.t[0]+A.R[3+r]*A.t[1]+A.R[6+r]*A.t[2]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_from_quaternion(const double q[4], const double t[3], RigidTransform &T)
+{
+    // Quaternion is normalized first
+    double x=q[0],y=q[1],z=q[2],w=q[3];
+    const double norm=std::sqrt(x*x+y*y+z*z+w*w);
+    if(norm>0)
+    {
+        x/=norm;
+        y/=norm;
+        z/=norm;
+        w/=norm;
+    }
+    else
+        w=1;
+
+    T.R[0]=1-2*(y*y+z*z); T.R[1]=2*(x*y-z*w);   T.R[2]=2*(x*z+y*w);
+    T.R[3]=2*(x*y+z*w);   T.R[4]=1-2*(x*x+z*z); T.R[5]=2*(y*z-x*w);
+    T.R[6]=2*(x*z-y*w);   T.R[7]=2*(y*z+x*w);   T.R[8]=1-2*(x*x+y*y);
+    T.t[0]=t[0];
+    T.t[1]=t[1];
+    T.t[2]=t[2];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_to_quaternion(const RigidTransform &T, double q[4])
+{
+    // Largest of diagonal elements is used, numerically stable for all rotations
+    const double *R=T.R;
+    const double trace=R[0]+R[4]+R[8];
+    if(trace>0)
+    {
+        const double s=0.5/std::sqrt(trace+1.0);
+        q[3]=0.25/s;
+        q[0]=(R[7]-R[5])*s;
+        q[1]=(R[2]-R[6])*s;
+        q[2]=(R[3]-R[1])*s;
+    }
+    else if((R[0]>R[4])&&(R[0]>R[8]))
+    {
+        const double s=2.0*std::sqrt(1.0+R[0]-R[4]-R[8]);
+        q[3]=(R[7]-R[5])/s;
+        q[0]=0.25*s;
+        q[1]=(R[1]+R[3])/s;
+        q[2]=(R[2]+R[6])/s;
+    }
+    else if(R[4]>R[8])
+    {
+        const double s=2.0*std::sqrt(1.0+R[4]-R[0]-R[8]);
+        q[3]=(R[2]-R[6])/s;
+        q[0]=(R[1]+R[3])/s;
+        q[1]=0.25*s;
+        q[2]=(R[5]+R[7])/s;
+    }
+    else
+    {
+        const double s=2.0*std::sqrt(1.0+R[8]-R[0]-R[4]);
+        q[3]=(R[3]-R[1])/s;
+        q[0]=(R[2]+R[6])/s;
+        q[1]=(R[5]+R[7])/s;
+        q[2]=0.25*s;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+planar_compose(const PlanarTransform &A, const PlanarTransform &B, PlanarTransform &C)
+{
+    const double c=std::cos(A.yaw);
+    const double s=std::sin(A.yaw);
+    C.x=A.x+c*B.x-s*B.y;
+    C.y=A.y+s*B.x+c*B.y;
+    C.yaw=std::remainder(A.yaw+B.yaw,2*M_PI);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+planar_from_rigid(const RigidTransform &T, PlanarTransform &P)
+{
+    P.x=T.t[0];
+    P.y=T.t[1];
+    P.yaw=std::atan2(T.R[3],T.R[0]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+rigid_from_planar(const PlanarTransform &P, RigidTransform &T)
+{
+    const double c=std::cos(P.yaw);
+    const double s=std::sin(P.yaw);
+    T.R[0]=c; T.R[1]=-s; T.R[2]=0;
+    T.R[3]=s; T.R[4]=c;  T.R[5]=0;
+    T.R[6]=0; T.R[7]=0;  T.R[8]=1;
+    T.t[0]=P.x;
+    T.t[1]=P.y;
+    T.t[2]=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+RigidTransformArray::RigidTransformArray(size_t count)
+{
+    resize(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::resize(size_t count)
+{
+    for(int k=0;k<9;k++)
+        R[k].resize(count,((k%4)==0)?1.0:0.0);
+    for(int k=0;k<3;k++)
+        t[k].resize(count,0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::reserve(size_t count)
+{
+    for(int k=0;k<9;k++)
+        R[k].reserve(count);
+    for(int k=0;k<3;k++)
+        t[k].reserve(count);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::set(size_t i, const RigidTransform &T)
+{
+    for(int k=0;k<9;k++)
+        R[k][i]=T.R[k];
+    for(int k=0;k<3;k++)
+        t[k][i]=T.t[k];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::get(size_t i, RigidTransform &T) const
+{
+    for(int k=0;k<9;k++)
+        T.R[k]=R[k][i];
+    for(int k=0;k<3;k++)
+        T.t[k]=t[k][i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::invert()
+{
+    const size_t count=size();
+    if(count==0)
+        return;
+
+    double *r00=&R[0][0],*r01=&R[1][0],*r02=&R[2][0];
+    double *r10=&R[3][0],*r11=&R[4][0],*r12=&R[5][0];
+    double *r20=&R[6][0],*r21=&R[7][0],*r22=&R[8][0];
+    double *tx=&t[0][0],*ty=&t[1][0],*tz=&t[2][0];
+
+    for(size_t i=0;i<count;i++)
+    {
+        // Translation -R^T*t
+        const double x=tx[i],y=ty[i],z=tz[i];
+        tx[i]=-(r00[i]*x+r10[i]*y+r20[i]*z);
+        ty[i]=-(r01[i]*x+r11[i]*y+r21[i]*z);
+        tz[i]=-(r02[i]*x+r12[i]*y+r22[i]*z);
+
+        // Transposition of rotation
+        double swap;
+        swap=r01[i]; r01[i]=r10[i]; r10[i]=swap;
+        swap=r02[i]; r02[i]=r20[i]; r20[i]=swap;
+        swap=r12[i]; r12[i]=r21[i]; r21[i]=swap;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::compose_left(const RigidTransformArray &left)
+{
+    const size_t count=size();
+    if((count==0)||(left.size()!=count))
+        return;
+
+    double *r[9],*p[3];
+    const double *a[9],*b[3];
+    for(int k=0;k<9;k++)
+    {
+        r[k]=&R[k][0];
+        a[k]=&left.R[k][0];
+    }
+    for(int k=0;k<3;k++)
+    {
+        p[k]=&t[k][0];
+        b[k]=&left.t[k][0];
+    }
+
+    for(size_t i=0;i<count;i++)
+    {
+        // Columns of right matrix are read before they are overwritten
+        const double c00=r[0][i],c01=r[1][i],c02=r[2][i];
+        const double c10=r[3][i],c11=r[4][i],c12=r[5][i];
+        const double c20=r[6][i],c21=r[7][i],c22=r[8][i];
+        const double x=p[0][i],y=p[1][i],z=p[2][i];
+        for(int row=0;row<3;row++)
+        {
+            const double a0=a[3*row][i],a1=a[3*row+1][i],a2=a[3*row+2][i];
+            r[3*row][i]  =a0*c00+a1*c10+a2*c20;
+            r[3*row+1][i]=a0*c01+a1*c11+a2*c21;
+            r[3*row+2][i]=a0*c02+a1*c12+a2*c22;
+            p[row][i]=a0*x+a1*y+a2*z+b[row][i];
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::gather(const RigidTransformArray &source, const std::vector<int> &indexes)
+{
+    resize(indexes.size());
+    for(int k=0;k<9;k++)
+    {
+        for(size_t i=0;i<indexes.size();i++)
+            R[k][i]=source.R[k][indexes[i]];
+    }
+    for(int k=0;k<3;k++)
+    {
+        for(size_t i=0;i<indexes.size();i++)
+            t[k][i]=source.t[k][indexes[i]];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+RigidTransformArray::scatter(const std::vector<int> &indexes, RigidTransformArray &destination) const
+{
+    for(int k=0;k<9;k++)
+    {
+        for(size_t i=0;i<indexes.size();i++)
+            destination.R[k][indexes[i]]=R[k][i];
+    }
+    for(int k=0;k<3;k++)
+    {
+        for(size_t i=0;i<indexes.size();i++)
+            destination.t[k][indexes[i]]=t[k][i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,157 @@
+/*********************************************************************************************//**
+* @file stationary_detector.cpp
+*
+* Detection of unchanged scene by difference of subsampled images source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <stationary_detector.h>
+
+// Standarc C++ libraries
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+StationaryDetector::StationaryDetector() :
+    threshold(0),                                        // detection is off
+    step(8),                                             // every 8th pixel of every 8th row
+    maxChanged(0.01),                                    // 1% of changed pixels
+    hold(5),                                             // 5 images without change
+    stillFrames(0),                                      // no image
+    referenceSize(0,0)                                   // no reference
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StationaryDetector::set_threshold(int paramThreshold)
+{
+    threshold=(paramThreshold<0)?0:paramThreshold;
+    reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StationaryDetector::set_step(int paramStep)
+{
+    step=(paramStep<1)?1:paramStep;
+    reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StationaryDetector::set_max_changed(double paramMaxChanged)
+{
+    maxChanged=paramMaxChanged;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StationaryDetector::set_hold(int paramHold)
+{
+    hold=(paramHold<1)?1:paramHold;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+StationaryDetector::reset()
+{
+    referenceSize=cv::Size(0,0);
+    stillFrames=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+int
+StationaryDetector::sample(const cv::Mat &image)
+{
+    // Grid is copied to contiguous array, buffer is allocated only for new size of image
+    const int columns=(image.cols+step-1)/step;
+    const int rows=(image.rows+step-1)/step;
+    current.resize(columns*rows);
+    unsigned char *destination=&current[0];
+    for(int y=0;y<image.rows;y+=step)
+    {
+        const uchar *row=image.ptr<uchar>(y);
+        for(int x=0;x<image.cols;x+=step)
+            *destination++=row[x];
+    }
+    return columns*rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool
+StationaryDetector::update(const cv::Mat &image)
+{
+    if((enabled()==false)||(image.empty()==true))
+        return false;
+
+    const int count=sample(image);
+
+    // First image or new size of image is reference
+    if(referenceSize!=image.size())
+    {
+        reference.swap(current);
+        referenceSize=image.size();
+        stillFrames=0;
+        return false;
+    }
+
+    // Loop over contiguous arrays without branches, compiler can vectorize it
+    const unsigned char *a=&reference[0];
+    const unsigned char *b=&current[0];
+    int32_t changed=0;
+    for(int i=0;i<count;i++)
+    {
+        const int32_t difference=(int32_t)a[i]-(int32_t)b[i];
+        changed+=((difference>threshold)|(difference<-threshold));
+    }
+
+    // Motion, actual image is new reference
+    if(changed>maxChanged*count)
+    {
+        reference.swap(current);
+        stillFrames=0;
+        return false;
+    }
+
+    stillFrames++;
+    return stillFrames>=hold;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,224 @@
+/*********************************************************************************************//**
+* @file synthetic_scene.cpp
+*
+* Synthetic images of marker field with known ground truth source file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+#include <synthetic_scene.h>
+
+// Standarc C++ libraries
+#include <cmath>
+#include <iostream>
+
+// Aruco libraries
+#include <aruco/arucofidmarkers.h>
+
+// OpenCV libraries
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Size of rendered marker texture, aruco markers have 7x7 cells
+#define SYNTHETIC_MARKER_TEXTURE 140
+// Corners closer to camera plane are not rendered [m]
+#define SYNTHETIC_NEAR_PLANE 0.05
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+SyntheticScene::SyntheticScene() :
+    imageSize(640,480),                                  // VGA image
+    markerSize(0.1),                                     // marker size in m
+    blurSigma(0),                                        // no blur
+    noiseSigma(0),                                       // no noise
+    rng(0)                                               // same scene for every run
+{
+    cornersCamera.resize(4);
+    cornersImage.resize(4);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::set_camera(const cv::Mat &paramCameraMatrix, const cv::Mat &paramDistortion, cv::Size paramImageSize)
+{
+    paramCameraMatrix.convertTo(cameraMatrix,CV_64F);
+    paramDistortion.convertTo(distortion,CV_64F);
+    imageSize=paramImageSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::set_marker_size(double paramMarkerSize)
+{
+    markerSize=paramMarkerSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::set_blur(double sigma)
+{
+    blurSigma=sigma;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::set_noise(double sigma)
+{
+    noiseSigma=sigma;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::generate(const std::vector<int> &markerIDs, double spacing, bool space3D, unsigned int seed)
+{
+    rng=cv::RNG(seed);
+    sceneMarkers.resize(markerIDs.size());
+    markerImages.resize(markerIDs.size());
+
+    // Markers are in rows along X axis, grid is close to square
+    const int columns=(int)std::ceil(std::sqrt((double)markerIDs.size()));
+    for(size_t i=0;i<markerIDs.size();i++)
+    {
+        SyntheticMarker &sceneMarker=sceneMarkers[i];
+        sceneMarker.markerID=markerIDs[i];
+        rigid_identity(sceneMarker.pose);
+        sceneMarker.pose.t[0]=(i%columns)*spacing;
+        sceneMarker.pose.t[1]=(i/columns)*spacing;
+
+        // Height up to quarter of spacing and tilt up to 15 degrees, first marker stays in origin
+        if((space3D==true)&&(i>0))
+        {
+            sceneMarker.pose.t[2]=rng.uniform(-0.25,0.25)*spacing;
+            const double tilt=rng.uniform(-15.0,15.0)*CV_PI/180.0;
+            const double direction=rng.uniform(0.0,2.0*CV_PI);
+            const double q[4]={std::cos(direction)*std::sin(tilt/2),std::sin(direction)*std::sin(tilt/2),0,std::cos(tilt/2)};
+            rigid_from_quaternion(q,sceneMarker.pose.t,sceneMarker.pose);
+        }
+
+        markerImages[i]=aruco::FiducidalMarkers::createMarkerImage(markerIDs[i],SYNTHETIC_MARKER_TEXTURE);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::render(const RigidTransform &camera, cv::Mat &image)
+{
+    image.create(imageSize,CV_8UC1);
+    image.setTo(cv::Scalar(255));
+
+    RigidTransform worldToCamera,markerToCamera;
+    rigid_invert(camera,worldToCamera);
+
+    // Corners of texture - top left, top right, bottom right and bottom left
+    // aruco returns corners of detected marker in this order, they correspond to corners of marker frame
+    const float textureSize=(float)SYNTHETIC_MARKER_TEXTURE;
+    const cv::Point2f textureCorners[4]={cv::Point2f(0,0),cv::Point2f(textureSize,0),
+                                         cv::Point2f(textureSize,textureSize),cv::Point2f(0,textureSize)};
+    const double h=markerSize/2.0;
+    const double objectX[4]={-h,-h,h,h};
+    const double objectY[4]={-h,h,h,-h};
+    const cv::Mat zero=cv::Mat::zeros(3,1,CV_64F);
+
+    for(size_t i=0;i<sceneMarkers.size();i++)
+    {
+        rigid_compose(worldToCamera,sceneMarkers[i].pose,markerToCamera);
+
+        // Marker has to be in front of camera and facing to it
+        bool visible=(markerToCamera.R[8]<0);
+        for(int k=0;(k<4)&&(visible==true);k++)
+        {
+            const double *R=markerToCamera.R;
+            const double *t=markerToCamera.t;
+            cornersCamera[k].x=(float)(R[0]*objectX[k]+R[1]*objectY[k]+t[0]);
+            cornersCamera[k].y=(float)(R[3]*objectX[k]+R[4]*objectY[k]+t[1]);
+            cornersCamera[k].z=(float)(R[6]*objectX[k]+R[7]*objectY[k]+t[2]);
+            visible=(cornersCamera[k].z>SYNTHETIC_NEAR_PLANE);
+        }
+        if(visible==false)
+            continue;
+
+        cv::projectPoints(cornersCamera,zero,zero,cameraMatrix,distortion,cornersImage);
+
+        // Markers completely out of image are skipped
+        float minX=cornersImage[0].x,maxX=minX,minY=cornersImage[0].y,maxY=minY;
+        for(int k=1;k<4;k++)
+        {
+            minX=std::min(minX,cornersImage[k].x);
+            maxX=std::max(maxX,cornersImage[k].x);
+            minY=std::min(minY,cornersImage[k].y);
+            maxY=std::max(maxY,cornersImage[k].y);
+        }
+        if((maxX<0)||(maxY<0)||(minX>=imageSize.width)||(minY>=imageSize.height))
+            continue;
+
+        // Distortion is applied to corners, texture between them is warped by homography
+        const cv::Mat H=cv::getPerspectiveTransform(textureCorners,&cornersImage[0]);
+        cv::warpPerspective(markerImages[i],image,H,imageSize,cv::INTER_LINEAR,cv::BORDER_TRANSPARENT);
+    }
+
+    if(blurSigma>0)
+        cv::GaussianBlur(image,image,cv::Size(0,0),blurSigma);
+
+    if(noiseSigma>0)
+    {
+        noise.create(imageSize,CV_16SC1);
+        rng.fill(noise,cv::RNG::NORMAL,0,noiseSigma);
+        cv::add(image,noise,image,cv::noArray(),CV_8U);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+
+void
+SyntheticScene::ground_truth(const RigidTransform &camera, RigidTransform &position) const
+{
+    // ROS frame of marker to marker plane frame - X and Y are negated, Z is normal of marker in both
+    RigidTransform rosToMarker;
+    rigid_identity(rosToMarker);
+    rosToMarker.R[0]=-1;
+    rosToMarker.R[4]=-1;
+
+    // World of estimator is ROS frame of first marker, transform is self inverse
+    RigidTransform firstMarkerInverse,cameraInFirst;
+    rigid_invert(sceneMarkers[0].pose,firstMarkerInverse);
+    rigid_compose(firstMarkerInverse,camera,cameraInFirst);
+    rigid_compose(rosToMarker,cameraInFirst,position);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
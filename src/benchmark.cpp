@@ -0,0 +1,309 @@
+/*********************************************************************************************//**
+* @file benchmark.cpp
+*
+* ArUco Positioning System benchmark on synthetic images main file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+// Standarc C++ libraries
+#include    <iostream>
+#include    <vector>
+#include    <algorithm>
+#include    <cmath>
+#include    <cstring>
+#include    <chrono>
+// Standard ROS libraries
+#include    <ros/ros.h>
+#include    <sensor_msgs/Image.h>
+#include    <sensor_msgs/image_encodings.h>
+// My libraries
+#include    <estimator.h>
+#include    <synthetic_scene.h>
+#include    <marker_id_filter.h>
+#include    <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Camera above the field looking down, it flies over whole field with changing yaw and tilt
+// Path starts above the first marker, it is origin of map
+static void
+camera_path(double s, double fieldX, double fieldY, double height, RigidTransform &camera)
+{
+    const double yaw=0.3*std::sin(2*CV_PI*s);
+    const double tilt=0.15*std::sin(4*CV_PI*s);
+    const double cy=std::cos(yaw),sy=std::sin(yaw);
+    const double ct=std::cos(tilt),st=std::sin(tilt);
+
+    // Yaw around world Z, camera axes X - world X, Y - world -Y, Z - world -Z, tilt around camera X
+    RigidTransform yawTransform,down,tiltTransform,yawDown;
+    rigid_identity(yawTransform);
+    yawTransform.R[0]=cy; yawTransform.R[1]=-sy;
+    yawTransform.R[3]=sy; yawTransform.R[4]=cy;
+    rigid_identity(down);
+    down.R[4]=-1;
+    down.R[8]=-1;
+    rigid_identity(tiltTransform);
+    tiltTransform.R[4]=ct; tiltTransform.R[5]=-st;
+    tiltTransform.R[7]=st; tiltTransform.R[8]=ct;
+    rigid_compose(yawTransform,down,yawDown);
+    rigid_compose(yawDown,tiltTransform,camera);
+
+    camera.t[0]=fieldX*0.5*(1-std::cos(2*CV_PI*s));
+    camera.t[1]=fieldY*0.5*(1-std::cos(4*CV_PI*s));
+    camera.t[2]=height;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Angle of rotation between two transforms [rad]
+static double
+rotation_error(const RigidTransform &A, const RigidTransform &B)
+{
+    double trace=0;
+    for(int r=0;r<3;r++)
+        for(int c=0;c<3;c++)
+            trace+=A.R[3*r+c]*B.R[3*r+c];
+    const double cosine=std::max(-1.0,std::min(1.0,(trace-1.0)/2.0));
+    return std::acos(cosine);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static double
+percentile(const std::vector<double> &sorted, double p)
+{
+    if(sorted.empty()==true)
+        return 0;
+    size_t index=(size_t)(p*(sorted.size()-1)+0.5);
+    return sorted[index];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+    // ROS initialization
+    ros::init(argc,argv,"ArUco_positioning_system_benchmark");
+    // New node
+    ros::NodeHandle myNode;
+    std::cout << "ArUco_positioning_system_benchmark is running..." << std::endl;
+
+    // Parameters of benchmark
+    //--------------------------------------------------
+    int p_Markers=25;
+    int p_Frames=500;
+    int p_ImageWidth=0;
+    int p_ImageHeight=0;
+    int p_Seed=0;
+    double p_Spacing=0.5;
+    double p_CameraHeight=1.5;
+    double p_Blur=0.0;
+    double p_Noise=0.0;
+    double p_MaxPositionError=0.05;
+    double p_MaxRotationError=2.0;
+    myNode.getParam("benchmark_markers",p_Markers);
+    myNode.getParam("benchmark_frames",p_Frames);
+    myNode.getParam("benchmark_image_width",p_ImageWidth);
+    myNode.getParam("benchmark_image_height",p_ImageHeight);
+    myNode.getParam("benchmark_seed",p_Seed);
+    myNode.getParam("benchmark_marker_spacing",p_Spacing);
+    myNode.getParam("benchmark_camera_height",p_CameraHeight);
+    myNode.getParam("benchmark_blur",p_Blur);
+    myNode.getParam("benchmark_noise",p_Noise);
+    myNode.getParam("benchmark_max_position_error",p_MaxPositionError);
+    myNode.getParam("benchmark_max_rotation_error",p_MaxRotationError);
+
+    // Parameters of estimator, which are not set, are set for benchmark
+    double p_MarkerSize=0.1;
+    myNode.getParam("MarkerSize",p_MarkerSize);
+    std::string typeOfSpace("plane");
+    myNode.getParam("type_of_markers_space",typeOfSpace);
+    if(myNode.hasParam("markers_number")==false)
+        myNode.setParam("markers_number",p_Markers);
+    if(myNode.hasParam("start_now")==false)
+        myNode.setParam("start_now",true);
+    if(myNode.hasParam("show_image")==false)
+        myNode.setParam("show_image",false);
+    //--------------------------------------------------
+
+    // IDs of markers - the same filter as estimator uses
+    //--------------------------------------------------
+    std::string markersIdFilter(MARKER_ID_FILTER_DEFAULT);
+    std::string markersIdFilterFile("");
+    myNode.getParam("markers_id_filter",markersIdFilter);
+    myNode.getParam("markers_id_filter_file",markersIdFilterFile);
+    MarkerIdFilter markerIdFilter;
+    markerIdFilter.setup(markersIdFilter,markersIdFilterFile);
+
+    std::vector<int> markerIDs;
+    for(int id=0;(id<MARKER_ID_FILTER_SIZE)&&((int)markerIDs.size()<p_Markers);id++)
+    {
+        if(markerIdFilter.accepted(id))
+            markerIDs.push_back(id);
+    }
+    if((int)markerIDs.size()<p_Markers)
+        ROS_WARN("Only %d marker IDs are accepted by filter", (int)markerIDs.size());
+    if(markerIDs.empty()==true)
+        return 1;
+    //--------------------------------------------------
+
+    // Estimator loads calibration file, scene is rendered through the same camera model
+    //--------------------------------------------------
+    ViewPoint_Estimator myEstimator(&myNode,(float)p_MarkerSize);
+    // Size of calibration image by default, other sizes use intrinsics scaled like in estimator
+    const cv::Size calibrationSize=myEstimator.camera_parameters().CamSize;
+    if((p_ImageWidth<=0)||(p_ImageHeight<=0))
+    {
+        p_ImageWidth=(calibrationSize.width>0)?calibrationSize.width:640;
+        p_ImageHeight=(calibrationSize.height>0)?calibrationSize.height:480;
+    }
+    const aruco::CameraParameters cameraParameters=myEstimator.camera_parameters_of_size(cv::Size(p_ImageWidth,p_ImageHeight));
+
+    SyntheticScene scene;
+    scene.set_camera(cameraParameters.CameraMatrix,cameraParameters.Distorsion,cv::Size(p_ImageWidth,p_ImageHeight));
+    scene.set_marker_size(p_MarkerSize);
+    scene.set_blur(p_Blur);
+    scene.set_noise(p_Noise);
+    scene.generate(markerIDs,p_Spacing,(typeOfSpace!="plane"),(unsigned int)p_Seed);
+
+    const int columns=(int)std::ceil(std::sqrt((double)markerIDs.size()));
+    const int rows=((int)markerIDs.size()+columns-1)/columns;
+    const double fieldX=(columns-1)*p_Spacing;
+    const double fieldY=(rows-1)*p_Spacing;
+
+    std::cout << "Markers: " << markerIDs.size() << " (" << columns << "x" << rows << ", " << typeOfSpace << ")"
+              << ", image: " << p_ImageWidth << "x" << p_ImageHeight
+              << ", frames: " << p_Frames << std::endl;
+    //--------------------------------------------------
+
+    // Message with synthetic image, it is reused for every frame
+    sensor_msgs::ImagePtr imageMessage(new sensor_msgs::Image);
+    imageMessage->encoding=sensor_msgs::image_encodings::MONO8;
+    imageMessage->width=p_ImageWidth;
+    imageMessage->height=p_ImageHeight;
+    imageMessage->step=p_ImageWidth;
+    imageMessage->is_bigendian=0;
+    imageMessage->data.resize(p_ImageWidth*p_ImageHeight);
+
+    // Results
+    std::vector<double> latencies;
+    latencies.reserve(p_Frames);
+    int visibleFrames=0;
+    double sumPositionError=0,maxPositionError=0;
+    double sumRotationError=0,maxRotationError=0;
+    double processingTime=0;
+
+    cv::Mat image;
+    RigidTransform camera,truth;
+    for(int f=0;(f<p_Frames)&&(ros::ok());f++)
+    {
+        const double s=(p_Frames>1)?(double)f/(p_Frames-1):0.0;
+        camera_path(s,fieldX,fieldY,p_CameraHeight,camera);
+
+        // Rendering is not measured
+        scene.render(camera,image);
+        for(int r=0;r<p_ImageHeight;r++)
+            std::memcpy(&imageMessage->data[r*p_ImageWidth],image.ptr(r),p_ImageWidth);
+        imageMessage->header.stamp=ros::Time::now();
+        imageMessage->header.seq=f;
+
+        // Whole processing of one image - detection, pose, mapping and publishing
+        const std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+        myEstimator.image_callback(imageMessage);
+        const std::chrono::steady_clock::time_point stop=std::chrono::steady_clock::now();
+        const double latency=std::chrono::duration<double,std::milli>(stop-start).count();
+        latencies.push_back(latency);
+        processingTime+=latency;
+
+        // Error of global position
+        if(myEstimator.position_visible()==true)
+        {
+            scene.ground_truth(camera,truth);
+            const RigidTransform &estimate=myEstimator.world_position();
+            const double dx=estimate.t[0]-truth.t[0];
+            const double dy=estimate.t[1]-truth.t[1];
+            const double dz=estimate.t[2]-truth.t[2];
+            const double positionError=std::sqrt(dx*dx+dy*dy+dz*dz);
+            const double rotationError=rotation_error(estimate,truth)*180.0/CV_PI;
+            sumPositionError+=positionError;
+            sumRotationError+=rotationError;
+            maxPositionError=std::max(maxPositionError,positionError);
+            maxRotationError=std::max(maxRotationError,rotationError);
+            visibleFrames++;
+        }
+    }
+
+    // Report
+    //--------------------------------------------------
+    const int processedFrames=(int)latencies.size();
+    std::sort(latencies.begin(),latencies.end());
+    std::cout << "Processed frames: " << processedFrames << std::endl;
+    std::cout << "Mapped markers: " << myEstimator.number_of_mapped_markers() << "/" << markerIDs.size() << std::endl;
+    if(processingTime>0)
+        std::cout << "FPS: " << 1000.0*processedFrames/processingTime << std::endl;
+    std::cout << "Latency [ms] - mean: " << ((processedFrames>0)?processingTime/processedFrames:0.0)
+              << ", p50: " << percentile(latencies,0.5)
+              << ", p99: " << percentile(latencies,0.99)
+              << ", max: " << percentile(latencies,1.0) << std::endl;
+    std::cout << "Frames with position: " << visibleFrames << "/" << processedFrames
+              << ", bad frames: " << myEstimator.number_of_bad_frames() << std::endl;
+    if(visibleFrames>0)
+    {
+        std::cout << "Position error [m] - mean: " << sumPositionError/visibleFrames << ", max: " << maxPositionError << std::endl;
+        std::cout << "Rotation error [deg] - mean: " << sumRotationError/visibleFrames << ", max: " << maxRotationError << std::endl;
+    }
+    //--------------------------------------------------
+
+    // Check of accuracy, benchmark fails if estimator does not find position or mean error is too large
+    //--------------------------------------------------
+    if(visibleFrames==0)
+    {
+        ROS_ERROR("Benchmark failed: position was not found in any image");
+        return 2;
+    }
+    if(sumPositionError/visibleFrames>p_MaxPositionError)
+    {
+        ROS_ERROR("Benchmark failed: mean position error %f m is larger than %f m", sumPositionError/visibleFrames, p_MaxPositionError);
+        return 2;
+    }
+    if(sumRotationError/visibleFrames>p_MaxRotationError)
+    {
+        ROS_ERROR("Benchmark failed: mean rotation error %f deg is larger than %f deg", sumRotationError/visibleFrames, p_MaxRotationError);
+        return 2;
+    }
+    //--------------------------------------------------
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,258 @@
+/*********************************************************************************************//**
+* @file offline.cpp
+*
+* ArUco Positioning System offline processing of recorded datasets main file
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+// Standarc C++ libraries
+#include    <iostream>
+#include    <fstream>
+#include    <iomanip>
+#include    <vector>
+#include    <algorithm>
+#include    <thread>
+#include    <chrono>
+// Standard ROS libraries
+#include    <ros/ros.h>
+// My libraries
+#include    <estimator.h>
+#include    <dataset_reader.h>
+#include    <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Image of dataset and its detected markers
+typedef struct OfflineFrame
+{
+    ros::Time stamp;                                // time of image
+    cv::Mat image;                                  // Mono8 image, cropped to region of interest
+    cv::Point2d scale;                              // resolution relative to calibration in x and y
+    cv::Rect crop;                                  // region of interest in image
+    std::vector<aruco::Marker> markers;             // detected markers
+    FrameQuality quality;                           // sharpness and exposure of image
+} OfflineFrame;
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void
+write_pose(std::ostream &output, const RigidTransform &transform)
+{
+    double quaternion[4];
+    rigid_to_quaternion(transform,quaternion);
+    output << transform.t[0] << " " << transform.t[1] << " " << transform.t[2] << " "
+           << quaternion[0] << " " << quaternion[1] << " " << quaternion[2] << " " << quaternion[3];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+    // ROS initialization
+    ros::init(argc,argv,"ArUco_positioning_system_offline");
+    // New node
+    ros::NodeHandle myNode;
+    std::cout << "ArUco_positioning_system_offline is running..." << std::endl;
+
+    // Parameters of offline processing
+    //--------------------------------------------------
+    std::string p_Input("");
+    std::string p_ImageTopic("/image_raw");
+    std::string p_TrajectoryFile("trajectory.txt");
+    std::string p_MapFile("map.txt");
+    int p_Threads=0;
+    int p_Batch=0;
+    myNode.getParam("offline_input",p_Input);
+    myNode.getParam("offline_image_topic",p_ImageTopic);
+    myNode.getParam("offline_trajectory_file",p_TrajectoryFile);
+    myNode.getParam("offline_map_file",p_MapFile);
+    myNode.getParam("offline_threads",p_Threads);
+    myNode.getParam("offline_batch",p_Batch);
+
+    // All cores by default, batch is large enough for all threads
+    if(p_Threads<=0)
+        p_Threads=std::max(1,(int)std::thread::hardware_concurrency());
+    if(p_Batch<=0)
+        p_Batch=8*p_Threads;
+
+    // Images are not shown
+    if(myNode.hasParam("show_image")==false)
+        myNode.setParam("show_image",false);
+
+    double p_MarkerSize=0.1;
+    myNode.getParam("MarkerSize",p_MarkerSize);
+    //--------------------------------------------------
+
+    DatasetReader reader;
+    if(reader.open(p_Input,p_ImageTopic)==false)
+    {
+        ROS_ERROR("Dataset %s can not be opened, set parameter offline_input", p_Input.c_str());
+        return 1;
+    }
+
+    std::ofstream trajectoryFile(p_TrajectoryFile.c_str());
+    if(!trajectoryFile.is_open())
+    {
+        ROS_ERROR("Trajectory file %s can not be created", p_TrajectoryFile.c_str());
+        return 1;
+    }
+    trajectoryFile << std::setprecision(9);
+    trajectoryFile << "# time x y z qx qy qz qw" << std::endl;
+
+    // Estimator and one detector for each thread
+    //--------------------------------------------------
+    ViewPoint_Estimator myEstimator(&myNode,(float)p_MarkerSize);
+    std::vector<aruco::MarkerDetector> detectors(p_Threads);
+    for(int w=0;w<p_Threads;w++)
+        myEstimator.setup_detector(detectors[w]);
+
+    std::vector<OfflineFrame> frames(p_Batch);
+    std::vector<int> order(p_Batch);
+    std::vector<std::thread> workers;
+    workers.reserve(p_Threads);
+    std::cout << "Threads: " << p_Threads << ", batch: " << p_Batch << std::endl;
+    //--------------------------------------------------
+
+    // Preprocessing is the same as in node, images are copied because buffers of estimator are reused
+    sensor_msgs::ImageConstPtr message;
+    cv::Mat image;
+    ros::Time stamp;
+    const int progressFrames=1000;
+    int processedFrames=0;
+    int positionFrames=0;
+    const std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+    while(ros::ok())
+    {
+        // Batch of images is read in order of recording
+        int count=0;
+        while((count<p_Batch)&&(reader.read(message,image,stamp)==true))
+        {
+            if((message)&&(myEstimator.image_from_message(message,image)==false))
+                continue;
+            if(myEstimator.prepare_image(image,frames[count].scale,frames[count].crop)==false)
+                continue;
+            image.copyTo(frames[count].image);
+            frames[count].stamp=stamp;
+            count++;
+        }
+        if(count==0)
+            break;
+
+        // Detection and corner refinement of images in parallel, each thread has own detector
+        workers.clear();
+        for(int w=0;w<p_Threads;w++)
+        {
+            workers.push_back(std::thread([&,w]()
+            {
+                for(int i=w;i<count;i+=p_Threads)
+                {
+                    myEstimator.measure_frame(frames[i].image,frames[i].quality);
+                    myEstimator.detect_markers(detectors[w],frames[i].image,frames[i].markers);
+                }
+            }));
+        }
+        for(size_t w=0;w<workers.size();w++)
+            workers[w].join();
+
+        // Pose and mapping are sequential, in order of time
+        // Only images of one batch are sorted, images out of order by more than batch are processed as recorded
+        for(int i=0;i<count;i++)
+            order[i]=i;
+        std::stable_sort(order.begin(),order.begin()+count,[&frames](int a, int b)
+        {
+            return frames[a].stamp<frames[b].stamp;
+        });
+        for(int k=0;k<count;k++)
+        {
+            OfflineFrame &frame=frames[order[k]];
+            myEstimator.select_camera_model(frame.scale,frame.crop);
+            // Image skipped by quality gate has no position, position of previous image is not written again
+            const bool processed=myEstimator.process_detected_markers(frame.markers,frame.stamp,frame.quality);
+            if((processed==true)&&(myEstimator.position_visible()==true))
+            {
+                trajectoryFile << frame.stamp.toSec() << " ";
+                write_pose(trajectoryFile,myEstimator.world_position());
+                trajectoryFile << std::endl;
+                positionFrames++;
+            }
+        }
+
+        // Progress is reported after each progressFrames frames, independently of batch
+        const bool progress=((processedFrames+count)/progressFrames!=processedFrames/progressFrames);
+        processedFrames+=count;
+        if(progress==true)
+            std::cout << "Processed frames: " << processedFrames << std::endl;
+    }
+    const std::chrono::steady_clock::time_point stop=std::chrono::steady_clock::now();
+    const double seconds=std::chrono::duration<double>(stop-start).count();
+
+    // Map - global position of every mapped marker
+    //--------------------------------------------------
+    std::ofstream mapFile(p_MapFile.c_str());
+    if(mapFile.is_open())
+    {
+        mapFile << std::setprecision(9);
+        mapFile << "# id x y z qx qy qz qw" << std::endl;
+        // Last published version of map
+        MarkerMapSnapshots &snapshots=myEstimator.map_snapshots();
+        const int reader=snapshots.register_reader();
+        {
+            MarkerMapReadGuard map(snapshots,reader);
+            RigidTransform transform;
+            for(int j=0;(map.get()!=NULL)&&(j<map->numberOfMarkers);j++)
+            {
+                map->markerGlobeTransforms.get(j,transform);
+                mapFile << map->markerIDs[j] << " ";
+                write_pose(mapFile,transform);
+                mapFile << std::endl;
+            }
+        }
+        snapshots.unregister_reader(reader);
+    }
+    else
+        ROS_ERROR("Map file %s can not be created", p_MapFile.c_str());
+    //--------------------------------------------------
+
+    // Report
+    std::cout << "Processed frames: " << processedFrames << " in " << seconds << " s";
+    if(seconds>0)
+        std::cout << " (" << processedFrames/seconds << " FPS)";
+    std::cout << std::endl;
+    std::cout << "Frames with position: " << positionFrames << ", bad frames: " << myEstimator.number_of_bad_frames() << std::endl;
+    std::cout << "Mapped markers: " << myEstimator.number_of_mapped_markers() << std::endl;
+    std::cout << "Trajectory: " << p_TrajectoryFile << ", map: " << p_MapFile << std::endl;
+
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
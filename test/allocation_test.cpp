@@ -0,0 +1,210 @@
+/*********************************************************************************************//**
+* @file allocation_test.cpp
+*
+* Test of heap allocations in steady state processing of images
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+// Standarc C++ libraries
+#include    <cerrno>
+#include    <cstddef>
+#include    <cstring>
+#include    <vector>
+// Standard ROS libraries
+#include    <ros/ros.h>
+#include    <gtest/gtest.h>
+#include    <sensor_msgs/Image.h>
+#include    <sensor_msgs/image_encodings.h>
+// My libraries
+#include    <estimator.h>
+#include    <synthetic_scene.h>
+#include    <rigid_transform.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Allocations are counted only in thread of test and only during measured call
+static thread_local bool countAllocations=false;
+static thread_local long numberOfAllocations=0;
+
+// Functions of glibc allocator, the test replaces public allocation functions by counting wrappers
+// operator new of libstdc++ and cv::fastMalloc of OpenCV (malloc or posix_memalign) call them
+extern "C" void *__libc_malloc(std::size_t size);
+extern "C" void *__libc_calloc(std::size_t count, std::size_t size);
+extern "C" void *__libc_realloc(void *memory, std::size_t size);
+extern "C" void *__libc_memalign(std::size_t alignment, std::size_t size);
+extern "C" void __libc_free(void *memory);
+
+static inline void
+count_allocation()
+{
+    if(countAllocations==true)
+        numberOfAllocations++;
+}
+
+extern "C" void *
+malloc(std::size_t size)
+{
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+extern "C" void *
+calloc(std::size_t count, std::size_t size)
+{
+    count_allocation();
+    return __libc_calloc(count,size);
+}
+
+extern "C" void *
+realloc(void *memory, std::size_t size)
+{
+    count_allocation();
+    return __libc_realloc(memory,size);
+}
+
+extern "C" int
+posix_memalign(void **memory, std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    *memory=__libc_memalign(alignment,size);
+    return (*memory!=NULL)?0:ENOMEM;
+}
+
+extern "C" void *
+memalign(std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment,size);
+}
+
+extern "C" void *
+aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    count_allocation();
+    return __libc_memalign(alignment,size);
+}
+
+extern "C" void
+free(void *memory)
+{
+    __libc_free(memory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Count of recorded images, camera moves over them forward and back
+#define RECORDED_FRAMES 8
+// Count of warm-up images, map, tracker, pyramids and all buffers are complete after them
+#define WARM_UP_FRAMES 64
+// Count of measured images
+#define MEASURED_FRAMES 256
+
+TEST(SteadyState, ImageCallbackDoesNotAllocate)
+{
+    // Parameters of test.launch - tracking between detections and stationary check
+    ros::NodeHandle myNode;
+    ViewPoint_Estimator myEstimator(&myNode,0.1f);
+    const aruco::CameraParameters &cameraParameters=myEstimator.camera_parameters();
+    ASSERT_GT(cameraParameters.CamSize.width,0);
+
+    // Grid of markers below camera, IDs are accepted by default filter
+    std::vector<int> markerIDs;
+    for(int i=0;i<9;i++)
+        markerIDs.push_back(10*i);
+    SyntheticScene scene;
+    scene.set_camera(cameraParameters.CameraMatrix,cameraParameters.Distorsion,cameraParameters.CamSize);
+    scene.set_marker_size(0.1);
+    scene.generate(markerIDs,0.2,false,0);
+
+    // Recorded images - camera looking down above centre of grid moves by 5 mm between images
+    std::vector<sensor_msgs::ImagePtr> recorded;
+    cv::Mat image;
+    RigidTransform camera;
+    rigid_identity(camera);
+    camera.R[4]=-1;
+    camera.R[8]=-1;
+    camera.t[1]=0.2;
+    camera.t[2]=1.0;
+    for(int r=0;r<RECORDED_FRAMES;r++)
+    {
+        camera.t[0]=0.18+0.005*r;
+        scene.render(camera,image);
+        sensor_msgs::ImagePtr message(new sensor_msgs::Image);
+        message->encoding=sensor_msgs::image_encodings::MONO8;
+        message->width=image.cols;
+        message->height=image.rows;
+        message->step=image.cols;
+        message->is_bigendian=0;
+        message->data.resize(image.cols*image.rows);
+        for(int y=0;y<image.rows;y++)
+            std::memcpy(&message->data[y*image.cols],image.ptr(y),image.cols);
+        recorded.push_back(message);
+    }
+
+    // Each recorded image is sent twice, second one is stationary, allocations of each measured image are kept
+    std::vector<long> allocations(MEASURED_FRAMES,0);
+    for(int f=0;f<WARM_UP_FRAMES+MEASURED_FRAMES;f++)
+    {
+        const int step=(f/2)%(2*RECORDED_FRAMES-2);
+        const int r=(step<RECORDED_FRAMES)?step:2*RECORDED_FRAMES-2-step;
+
+        const long before=numberOfAllocations;
+        countAllocations=(f>=WARM_UP_FRAMES);
+        myEstimator.image_callback(recorded[r]);
+        countAllocations=false;
+        if(f>=WARM_UP_FRAMES)
+            allocations[f-WARM_UP_FRAMES]=numberOfAllocations-before;
+        ASSERT_TRUE(myEstimator.position_visible());
+    }
+    EXPECT_EQ(myEstimator.number_of_mapped_markers(),(int)markerIDs.size());
+
+    // First image with allocations helps to find the allocating step
+    for(int f=0;f<MEASURED_FRAMES;f++)
+    {
+        EXPECT_EQ(allocations[f],0) << "image " << f << " after warm-up";
+        if(allocations[f]!=0)
+            break;
+    }
+    EXPECT_EQ(numberOfAllocations,0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc,argv);
+    ros::init(argc,argv,"allocation_test");
+    return RUN_ALL_TESTS();
+}
+
+////////////////////////////////////////////////////////////////////////////////
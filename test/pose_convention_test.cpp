@@ -0,0 +1,149 @@
+/*********************************************************************************************//**
+* @file pose_convention_test.cpp
+*
+* Test of frame convention of marker poses
+*
+* Copyright (c)
+* Jan Bacik
+* Smart Robotic Systems
+* www.smartroboticsys.eu
+* March 2015
+*
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* Redistributions of source code must retain the above copyright notice, this
+* list of conditions and the following disclaimer.
+*
+* Redistributions in binary form must reproduce the above copyright notice,
+* this list of conditions and the following disclaimer in the documentation
+* and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+******************************************************************************/
+
+
+
+// Standarc C++ libraries
+#include    <cmath>
+// Standard ROS libraries
+#include    <gtest/gtest.h>
+// My libraries
+#include    <estimator.h>
+#include    <planar_pose_solver.h>
+#include    <rigid_transform.h>
+#include    <space_model.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Camera without distortion, it looks down to the floor from height 1.5 m and it is slightly tilted
+static const double cameraMatrix[4]={600.0,600.0,376.0,240.0};
+static const double distortion[5]={0,0,0,0,0};
+static const double cameraPosition[3]={0.2,0.1,1.5};
+static const double cameraTilt=0.2;
+static const double markerSize=0.1;
+
+// Pixel of point on the floor
+static cv::Point2f
+project(double X, double Y, double Z)
+{
+    // Camera X - world X, camera Y - world -Y, camera Z - world -Z, tilt around camera X
+    const double x=X-cameraPosition[0];
+    const double y=-(Y-cameraPosition[1]);
+    const double z=-(Z-cameraPosition[2]);
+    const double c=std::cos(cameraTilt),s=std::sin(cameraTilt);
+    const double yc=c*y-s*z;
+    const double zc=s*y+c*z;
+    return cv::Point2f((float)(cameraMatrix[0]*x/zc+cameraMatrix[2]),(float)(cameraMatrix[1]*yc/zc+cameraMatrix[3]));
+}
+
+// Transform of marker in camera frame in ROS convention, marker lies on the floor at given position
+static bool
+marker_in_camera(PlanarPoseSolver &solver, int id, double X, double Y, RigidTransform &transform)
+{
+    // Corners in order of aruco, marker frame is parallel to world
+    const double h=markerSize/2.0;
+    const cv::Point2f corners[4]={project(X-h,Y-h,0),project(X-h,Y+h,0),project(X+h,Y+h,0),project(X+h,Y-h,0)};
+    MarkerPose pose;
+    if(solver.solve_marker(id,corners,pose)==false)
+        return false;
+    ViewPoint_Estimator::arucoMarker2Transform(pose,transform);
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Markers on the floor have the same orientation, second marker is in their plane, Z of marker is the normal
+TEST(MarkerFrame, RelativePoseOfMarkersOnFloor)
+{
+    PlanarPoseSolver solver;
+    solver.set_camera(cameraMatrix,distortion);
+    solver.set_marker_size(markerSize);
+
+    const double offsets[2][2]={{0.5,0.0},{0.0,0.3}};
+    for(int n=0;n<2;n++)
+    {
+        RigidTransform first,second,cameraOverFirst,relative;
+        ASSERT_TRUE(marker_in_camera(solver,1,0.0,0.0,first));
+        ASSERT_TRUE(marker_in_camera(solver,2,offsets[n][0],offsets[n][1],second));
+        rigid_invert(first,cameraOverFirst);
+        rigid_compose(cameraOverFirst,second,relative);
+
+        // X and Y of marker are opposite to X and Y of aruco marker plane, offset is in plane of markers
+        EXPECT_NEAR(relative.t[0],-offsets[n][0],1e-4);
+        EXPECT_NEAR(relative.t[1],-offsets[n][1],1e-4);
+        EXPECT_NEAR(relative.t[2],0.0,1e-4);
+        // Same orientation, normal of marker is Z
+        for(int k=0;k<9;k++)
+            EXPECT_NEAR(relative.R[k],((k%4)==0)?1.0:0.0,1e-4);
+        // Camera is above the marker in direction of its normal
+        EXPECT_GT(cameraOverFirst.t[2],1.0);
+
+        // Map of plane keeps the offset
+        PlanarTransform planar;
+        EXPECT_TRUE(SpacePlane::relative(cameraOverFirst,second,planar));
+        EXPECT_NEAR(planar.x,-offsets[n][0],1e-4);
+        EXPECT_NEAR(planar.y,-offsets[n][1],1e-4);
+        EXPECT_NEAR(planar.yaw,0.0,1e-4);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Marker with normal far from normal of old marker is not in the plane of map
+TEST(MarkerFrame, PlaneRejectsTiltedMarker)
+{
+    RigidTransform oldCamera,tilted;
+    rigid_identity(oldCamera);
+    rigid_identity(tilted);
+    // Rotation by 60 deg around X
+    const double c=std::cos(CV_PI/3),s=std::sin(CV_PI/3);
+    tilted.R[4]=c; tilted.R[5]=-s;
+    tilted.R[7]=s; tilted.R[8]=c;
+    PlanarTransform planar;
+    EXPECT_FALSE(SpacePlane::relative(oldCamera,tilted,planar));
+    RigidTransform full;
+    EXPECT_TRUE(Space3D::relative(oldCamera,tilted,full));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc,argv);
+    return RUN_ALL_TESTS();
+}
+
+////////////////////////////////////////////////////////////////////////////////